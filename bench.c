@@ -0,0 +1,309 @@
+// Hot path microbenchmarks: lane queue, scheduler, dashboard renderer and
+// crossing journal. Each operation is timed at queue depths from 10 to
+// 1,000,000 vehicles (spread evenly over the four lanes) and reported per
+// operation, together with the heap allocations it made (counted by
+// wrapping malloc & co.). The journal append does not depend on depth and
+// runs once, against a writer thread draining to /dev/null.
+//
+//   ./bench [--json] [--max-depth N]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include "utils.h"
+#include "traffic_logic.h"
+#include "journal.h"
+
+#define MAX_DEPTH 1000000
+#define MIN_QUEUE_OPS 1000000   // Small depths are filled and drained repeatedly
+#define READ_ITERATIONS 1000000 // Repetitions of the O(1) queries
+#define BURIED_EMERGENCIES 1000 // Emergencies queued behind each depth
+#define DRAW_ITERATIONS 2000
+#define FRAME_BYTES (64 * 1024)
+
+// ---------------- Allocation Counting ----------------
+// Linked with -Wl,--wrap=malloc,... so calls from the code under test land here
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* p, size_t size);
+
+static long long alloc_count;
+static long long alloc_bytes;
+
+void* __wrap_malloc(size_t size) {
+    alloc_count++;
+    alloc_bytes += size;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+    alloc_count++;
+    alloc_bytes += n * size;
+    return __real_calloc(n, size);
+}
+
+void* __wrap_realloc(void* p, size_t size) {
+    alloc_count++;
+    alloc_bytes += size;
+    return __real_realloc(p, size);
+}
+
+// ---------------- Harness ----------------
+
+// Timed sections accumulate between bench_resume and bench_pause, so setup
+// work in between is excluded from both the time and the allocation counts
+typedef struct {
+    const char* op;
+    long depth;
+    long iterations;
+    int64_t elapsed_ns;
+    long long allocs;
+    long long bytes;
+    int64_t start_ns;
+    long long start_allocs;
+    long long start_bytes;
+} BenchRun;
+
+static int json_output = 0;
+static int rows_written = 0;
+static volatile long sink; // Keeps query results alive
+
+static void bench_resume(BenchRun* b) {
+    b->start_allocs = alloc_count;
+    b->start_bytes = alloc_bytes;
+    b->start_ns = monotonic_ns();
+}
+
+static void bench_pause(BenchRun* b) {
+    b->elapsed_ns += monotonic_ns() - b->start_ns;
+    b->allocs += alloc_count - b->start_allocs;
+    b->bytes += alloc_bytes - b->start_bytes;
+}
+
+static void bench_init(BenchRun* b, const char* op, long depth) {
+    memset(b, 0, sizeof(*b));
+    b->op = op;
+    b->depth = depth;
+}
+
+static void bench_begin(BenchRun* b, const char* op, long depth, long iterations) {
+    bench_init(b, op, depth);
+    b->iterations = iterations;
+    bench_resume(b);
+}
+
+static void bench_report(BenchRun* b) {
+    double ns_per_op = (double)b->elapsed_ns / b->iterations;
+    double allocs_per_op = (double)b->allocs / b->iterations;
+    double bytes_per_op = (double)b->bytes / b->iterations;
+
+    if (json_output) {
+        printf("%s\n  {\"op\": \"%s\", \"depth\": %ld, \"iterations\": %ld, \"ns_per_op\": %.2f, "
+               "\"allocs_per_op\": %.4f, \"bytes_per_op\": %.1f}",
+               rows_written ? "," : "", b->op, b->depth, b->iterations, ns_per_op, allocs_per_op, bytes_per_op);
+    } else {
+        printf("%s,%ld,%ld,%.2f,%.4f,%.1f\n", b->op, b->depth, b->iterations, ns_per_op, allocs_per_op, bytes_per_op);
+    }
+    rows_written++;
+    fflush(stdout);
+}
+
+static void bench_end(BenchRun* b) {
+    bench_pause(b);
+    bench_report(b);
+}
+
+static Vehicle make_vehicle(int id, int lane, int type) {
+    Vehicle v;
+    memset(&v, 0, sizeof(v));
+    v.id = id;
+    v.lane = lane;
+    v.type = type;
+    return v;
+}
+
+// `depth` regular cars, round robin over the lanes
+static void fill_lanes(LaneQueue lanes[], long depth) {
+    for (long i = 0; i < depth; i++) {
+        int lane = (int)(i % NUM_LANES);
+        add_vehicle(&lanes[lane], make_vehicle((int)i, lane, REGULAR_CAR));
+    }
+}
+
+static void free_lanes(LaneQueue lanes[]) {
+    for (int i = 0; i < NUM_LANES; i++) free_lane_queue(&lanes[i]);
+}
+
+// ---------------- Benchmarks ----------------
+
+// Fills one lane to `depth` and drains it, `rounds` times; a fresh queue
+// each round, so chunk allocation is part of what add_vehicle costs
+static void bench_add_remove(long depth) {
+    long rounds = depth < MIN_QUEUE_OPS ? MIN_QUEUE_OPS / depth : 1;
+    BenchRun add, remove, buried;
+    bench_init(&add, "add_vehicle", depth);
+    bench_init(&remove, "remove_vehicle", depth);
+    bench_init(&buried, "remove_vehicle_buried_emergency", depth);
+
+    for (long r = 0; r < rounds; r++) {
+        LaneQueue q;
+        init_lane_queue(&q);
+
+        bench_resume(&add);
+        for (long i = 0; i < depth; i++) add_vehicle(&q, make_vehicle((int)i, NORTH, REGULAR_CAR));
+        bench_pause(&add);
+
+        bench_resume(&remove);
+        for (long i = 0; i < depth; i++) sink = remove_vehicle(&q).id;
+        bench_pause(&remove);
+        free_lane_queue(&q);
+    }
+    add.iterations = remove.iterations = rounds * depth;
+    bench_report(&add);
+    bench_report(&remove);
+
+    // Emergencies queued behind `depth` cars are served first
+    LaneQueue q;
+    init_lane_queue(&q);
+    for (long i = 0; i < depth; i++) add_vehicle(&q, make_vehicle((int)i, NORTH, REGULAR_CAR));
+    for (int i = 0; i < BURIED_EMERGENCIES; i++) add_vehicle(&q, make_vehicle(-i, NORTH, AMBULANCE));
+    bench_resume(&buried);
+    for (int i = 0; i < BURIED_EMERGENCIES; i++) sink = remove_vehicle(&q).id;
+    bench_pause(&buried);
+    buried.iterations = BURIED_EMERGENCIES;
+    bench_report(&buried);
+    free_lane_queue(&q);
+
+    // `depth` emergencies between two cars: serving the first car scans
+    // every type byte in between to find the next regular one
+    BenchRun scan;
+    bench_init(&scan, "remove_vehicle_scan_past_emergencies", depth);
+    for (long r = 0; r < rounds; r++) {
+        init_lane_queue(&q);
+        add_vehicle(&q, make_vehicle(0, NORTH, REGULAR_CAR));
+        for (long i = 0; i < depth; i++) add_vehicle(&q, make_vehicle((int)i, NORTH, AMBULANCE));
+        add_vehicle(&q, make_vehicle(1, NORTH, REGULAR_CAR));
+        // Drop the emergency FIFOs so the head car is served next
+        q.emergency[CLASS_AMBULANCE].head = q.emergency[CLASS_AMBULANCE].tail;
+        q.emergency_classes = 0;
+        bench_resume(&scan);
+        sink = remove_vehicle(&q).id;
+        bench_pause(&scan);
+        free_lane_queue(&q);
+    }
+    scan.iterations = rounds;
+    bench_report(&scan);
+
+    // A car, `depth` emergencies already served, more cars: the dashboard
+    // preview is read off the lane summary, not rescanned past the gap
+    init_lane_queue(&q);
+    add_vehicle(&q, make_vehicle(0, NORTH, REGULAR_CAR));
+    for (long i = 0; i < depth; i++) add_vehicle(&q, make_vehicle((int)i, NORTH, AMBULANCE));
+    for (int i = 1; i < SCENE_PREVIEW; i++) add_vehicle(&q, make_vehicle(i, NORTH, REGULAR_CAR));
+    for (long i = 0; i < depth; i++) remove_vehicle(&q);
+    Vehicle preview[SCENE_PREVIEW];
+    BenchRun peek;
+    bench_begin(&peek, "peek_vehicles_past_served", depth, READ_ITERATIONS);
+    for (long i = 0; i < READ_ITERATIONS; i++) sink = peek_vehicles(&q, preview, SCENE_PREVIEW);
+    bench_end(&peek);
+    free_lane_queue(&q);
+}
+
+static void bench_queries(long depth) {
+    PriorityIndex index; // Kept current by the lanes, as a controller's is
+    priority_index_attach(&index, lane_queues, NUM_LANES);
+    fill_lanes(lane_queues, depth);
+    BenchRun b;
+
+    bench_begin(&b, "count_vehicles", depth, READ_ITERATIONS);
+    for (long i = 0; i < READ_ITERATIONS; i++) sink = count_vehicles(&lane_queues[i % NUM_LANES]);
+    bench_end(&b);
+
+    bench_begin(&b, "has_emergency", depth, READ_ITERATIONS);
+    for (long i = 0; i < READ_ITERATIONS; i++) sink = has_emergency((int)(i % NUM_LANES));
+    bench_end(&b);
+
+    bench_begin(&b, "is_any_emergency_active", depth, READ_ITERATIONS);
+    for (long i = 0; i < READ_ITERATIONS; i++) sink = is_any_emergency_active();
+    bench_end(&b);
+
+    bench_begin(&b, "select_next_lane", depth, READ_ITERATIONS);
+    for (long i = 0; i < READ_ITERATIONS; i++) sink = select_next_lane((int)(i % NUM_LANES));
+    bench_end(&b);
+
+    bench_begin(&b, "priority_index_next", depth, READ_ITERATIONS);
+    for (long i = 0; i < READ_ITERATIONS; i++) sink = priority_index_next(&index, (int)(i % NUM_LANES), CLASS_CAR);
+    bench_end(&b);
+
+    bench_begin(&b, "handle_aging", depth, READ_ITERATIONS);
+    for (long i = 0; i < READ_ITERATIONS; i++) handle_aging(&lane_queues[i % NUM_LANES]);
+    bench_end(&b);
+
+    static char frame[FRAME_BYTES];
+    FILE* out = fmemopen(frame, sizeof(frame), "w");
+    if (out != NULL) {
+        Vehicle crossing[NUM_LANES];
+        for (int l = 0; l < NUM_LANES; l++) crossing[l].id = -1;
+        crossing[EAST] = make_vehicle(42, EAST, AMBULANCE);
+        bench_begin(&b, "draw_traffic_scene", depth, DRAW_ITERATIONS);
+        for (long i = 0; i < DRAW_ITERATIONS; i++) {
+            rewind(out);
+            draw_traffic_scene_to(out, lane_queues, 1u << (i % NUM_LANES), crossing);
+            fflush(out);
+        }
+        bench_end(&b);
+        fclose(out);
+    }
+
+    free_lanes(lane_queues);
+}
+
+static void bench_journal(void) {
+    Journal j;
+    if (journal_open(&j, "/dev/null", 0, 0, 0) != 0) return;
+    JournalRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    BenchRun b;
+    bench_begin(&b, "journal_append", 0, READ_ITERATIONS);
+    for (long i = 0; i < READ_ITERATIONS; i++) {
+        rec.id = (int32_t)i;
+        rec.crossed_ns = i;
+        journal_append(&j, &rec);
+        if (i % (JOURNAL_RING_CAPACITY / 2) == 0) {
+            // Untimed: let the writer drain, so every append is queued, not dropped
+            bench_pause(&b);
+            while (spsc_ring_size(j.ring) > 0) sched_yield();
+            bench_resume(&b);
+        }
+    }
+    bench_end(&b);
+    journal_close(&j); // /dev/null cannot be synced: the result is meaningless here
+}
+
+int main(int argc, char* argv[]) {
+    long max_depth = MAX_DEPTH;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) json_output = 1;
+        else if (strcmp(argv[i], "--max-depth") == 0 && i + 1 < argc) max_depth = atol(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--json] [--max-depth N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    init_traffic_system();
+    for (int i = 0; i < 5; i++) log_vehicle(make_vehicle(i, i % NUM_LANES, i % 2 ? POLICE : REGULAR_CAR));
+
+    if (json_output) printf("[");
+    else printf("op,depth,iterations,ns_per_op,allocs_per_op,bytes_per_op\n");
+    for (long depth = 10; depth <= max_depth; depth *= 10) {
+        bench_add_remove(depth);
+        bench_queries(depth);
+    }
+    bench_journal();
+    if (json_output) printf("\n]\n");
+
+    cleanup_traffic_system();
+    return 0;
+}
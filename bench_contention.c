@@ -0,0 +1,169 @@
+// Lane ingestion contention benchmark: one global mutex vs per-lane
+// lock-free intakes. P producer threads submit vehicles while one consumer
+// (the controller's role) moves them into the lanes and serves them.
+//
+//   mutex:  producers lock, add_vehicle, unlock; the consumer serves under
+//           the same lock (the old queue_mutex design)
+//   intake: producers lane_intake_push; the consumer owns the lanes and
+//           drains the intakes without any lock
+//
+// producer_wait is the time spent getting the vehicle in: lock acquisition
+// for the mutex, the push itself (including CAS retries and waits on a
+// full intake) for the intake. consumer_wait is the consumer's lock
+// acquisition time per pass.
+//
+//   ./bench_contention [vehicles_per_producer]
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include "utils.h"
+#include "lane_intake.h"
+
+#define MAX_PRODUCERS 16
+
+enum { MODE_MUTEX, MODE_INTAKE };
+
+typedef struct {
+    int mode;
+    long per_producer;
+    long expected;
+    pthread_mutex_t lock;
+    LaneQueue lanes[NUM_LANES];
+    LaneIntake intakes[NUM_LANES];
+    pthread_barrier_t start;
+} Shared;
+
+typedef struct {
+    Shared* sh;
+    int id;
+    int64_t wait_ns;
+    int64_t max_wait_ns;
+    long long consumer_passes;
+} Worker;
+
+static void* producer(void* arg) {
+    Worker* w = arg;
+    Shared* sh = w->sh;
+    pthread_barrier_wait(&sh->start);
+
+    for (long i = 0; i < sh->per_producer; i++) {
+        Vehicle v;
+        memset(&v, 0, sizeof(v));
+        v.id = (int)(w->id * sh->per_producer + i);
+        v.lane = (int)((w->id + i) % NUM_LANES);
+        v.type = (i % 50 == 0) ? AMBULANCE : REGULAR_CAR;
+
+        int64_t t0 = monotonic_ns();
+        if (sh->mode == MODE_MUTEX) {
+            pthread_mutex_lock(&sh->lock);
+            int64_t waited = monotonic_ns() - t0;
+            add_vehicle(&sh->lanes[v.lane], v);
+            pthread_mutex_unlock(&sh->lock);
+            w->wait_ns += waited;
+            if (waited > w->max_wait_ns) w->max_wait_ns = waited;
+        } else {
+            while (lane_intake_push(&sh->intakes[v.lane], &v) != 0) sched_yield();
+            int64_t waited = monotonic_ns() - t0;
+            w->wait_ns += waited;
+            if (waited > w->max_wait_ns) w->max_wait_ns = waited;
+        }
+    }
+    return NULL;
+}
+
+static void* consumer(void* arg) {
+    Worker* w = arg;
+    Shared* sh = w->sh;
+    pthread_barrier_wait(&sh->start);
+
+    long served = 0;
+    while (served < sh->expected) {
+        long before = served;
+        if (sh->mode == MODE_MUTEX) {
+            int64_t t0 = monotonic_ns();
+            pthread_mutex_lock(&sh->lock);
+            w->wait_ns += monotonic_ns() - t0;
+            for (int i = 0; i < NUM_LANES; i++) {
+                while (count_vehicles(&sh->lanes[i]) > 0) {
+                    remove_vehicle(&sh->lanes[i]);
+                    served++;
+                }
+            }
+            pthread_mutex_unlock(&sh->lock);
+        } else {
+            for (int i = 0; i < NUM_LANES; i++) {
+                lane_intake_drain(&sh->intakes[i], &sh->lanes[i]);
+                while (count_vehicles(&sh->lanes[i]) > 0) {
+                    remove_vehicle(&sh->lanes[i]);
+                    served++;
+                }
+            }
+        }
+        w->consumer_passes++;
+        if (served == before) sched_yield();
+    }
+    return NULL;
+}
+
+static int run(int mode, int producers, long per_producer) {
+    Shared sh;
+    memset(&sh, 0, sizeof(sh));
+    sh.mode = mode;
+    sh.per_producer = per_producer;
+    sh.expected = per_producer * producers;
+    pthread_mutex_init(&sh.lock, NULL);
+    for (int i = 0; i < NUM_LANES; i++) {
+        if (lane_intake_init(&sh.intakes[i], LANE_INTAKE_CAPACITY) != 0) return -1;
+    }
+    pthread_barrier_init(&sh.start, NULL, producers + 2);
+
+    Worker workers[MAX_PRODUCERS + 1];
+    pthread_t threads[MAX_PRODUCERS + 1];
+    memset(workers, 0, sizeof(workers));
+    for (int i = 0; i <= producers; i++) {
+        workers[i].sh = &sh;
+        workers[i].id = i;
+        pthread_create(&threads[i], NULL, i < producers ? producer : consumer, &workers[i]);
+    }
+    pthread_barrier_wait(&sh.start);
+    int64_t start = monotonic_ns();
+    for (int i = 0; i <= producers; i++) pthread_join(threads[i], NULL);
+    double seconds = (monotonic_ns() - start) / 1e9;
+
+    int64_t wait = 0, max_wait = 0;
+    for (int i = 0; i < producers; i++) {
+        wait += workers[i].wait_ns;
+        if (workers[i].max_wait_ns > max_wait) max_wait = workers[i].max_wait_ns;
+    }
+    Worker* c = &workers[producers];
+    printf("%s,%d,%ld,%.3f,%.0f,%.1f,%lld,%.1f\n", mode == MODE_MUTEX ? "mutex" : "intake", producers,
+           sh.expected, seconds, sh.expected / seconds, (double)wait / sh.expected, (long long)max_wait,
+           c->consumer_passes ? (double)c->wait_ns / c->consumer_passes : 0.0);
+    fflush(stdout);
+
+    for (int i = 0; i < NUM_LANES; i++) {
+        free_lane_queue(&sh.lanes[i]);
+        lane_intake_free(&sh.intakes[i]);
+    }
+    pthread_barrier_destroy(&sh.start);
+    pthread_mutex_destroy(&sh.lock);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    long per_producer = argc > 1 ? atol(argv[1]) : 200000;
+    if (per_producer <= 0) {
+        fprintf(stderr, "usage: %s [vehicles_per_producer]\n", argv[0]);
+        return 1;
+    }
+
+    printf("mode,producers,vehicles,seconds,vehicles_per_sec,producer_wait_ns_avg,producer_wait_ns_max,consumer_wait_ns_avg\n");
+    for (int p = 1; p <= MAX_PRODUCERS; p *= 2) {
+        if (run(MODE_MUTEX, p, per_producer) != 0 || run(MODE_INTAKE, p, per_producer) != 0) {
+            fprintf(stderr, "run with %d producers failed\n", p);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,160 @@
+// Controller ingest saturation benchmark: K forked load generator
+// processes fan into one controller over the shm rings. The consumer runs
+// the live ingest path (transport -> lane intakes -> lanes, with metrics)
+// and then discards the lanes, so the numbers are ingest alone, not the
+// junction's crossing capacity.
+//
+// offered is the configured rate, sent what the producers got into their
+// rings, ingested what reached the lanes. Below saturation the three
+// match and hand-off latency stays low; past it the rings fill, producers
+// stall and fall behind schedule (max_late_ms), and ingested flattens out
+// at the controller's capacity.
+//
+//   ./bench_ingest [seconds] [max_producers] [rate] [model]
+// rate is the total offered vehicles/s (0 = flat out); producers are
+// swept 1, 2, 4 ... max_producers.
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "loadgen.h"
+#include "controller.h"
+#include "metrics.h"
+
+#define LANE_DISCARD 65536 // Collected vehicles kept per lane before it is emptied
+
+typedef struct {
+    double sent_per_sec;
+    double ingested_per_sec;
+    double stalls_per_sec;
+    int64_t p50_ns;
+    int64_t p99_ns;
+    double max_late_ms;
+} IngestResult;
+
+static int run_phase(const LoadConfig* base, int producers, double seconds, IngestResult* out) {
+    destroy_queue();
+    TrafficChannel* ch = create_queue(TRANSPORT_SHM);
+    if (ch == NULL) return -1;
+    init_traffic_system();
+
+    // Run flag and producer counters, shared with the forked producers
+    size_t shared_bytes = sizeof(int) + CACHE_LINE + producers * sizeof(LoadStats);
+    unsigned char* shared = mmap(NULL, shared_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) return -1;
+    volatile int* running = (volatile int*)shared;
+    LoadStats* stats = (LoadStats*)(shared + CACHE_LINE);
+    *running = 1;
+
+    LoadConfig cfg = *base;
+    cfg.producers = producers;
+    pid_t pids[LOAD_MAX_PRODUCERS];
+    for (int k = 0; k < producers; k++) {
+        pids[k] = fork();
+        if (pids[k] == 0) {
+            loadgen_run(&cfg, TRANSPORT_SHM, k, running, &stats[k]);
+            _exit(0);
+        }
+    }
+
+    Controller ctl;
+    controller_init(&ctl, lane_queues, NULL, NULL);
+    ctl.intake = lane_intakes;
+    ctl.metrics = metrics_create(monotonic_ns());
+    HdrHistogram handoff;
+    hdr_init(&handoff);
+
+    VehicleMessage batch[64];
+    long long ingested = 0;
+    int64_t start = monotonic_ns();
+    int64_t end = start + (int64_t)(seconds * 1e9);
+    int64_t now = start;
+    while (now < end) {
+        int n = receive_vehicle_batch(ch, batch, 64);
+        now = monotonic_ns();
+        if (n <= 0) {
+            sched_yield(); // Let the producers run
+            continue;
+        }
+        for (int i = 0; i < n; i++) {
+            Vehicle v = { 0 };
+            v.id = batch[i].id;
+            v.type = batch[i].type;
+            v.lane = batch[i].lane;
+            v.arrival_time = batch[i].timestamp;
+            v.arrival_ns = batch[i].sent_ns;
+            while (submit_vehicle(&v) == SUBMIT_FULL) controller_collect_arrivals(&ctl);
+            hdr_record(&handoff, now - batch[i].sent_ns);
+        }
+        ingested += controller_collect_arrivals(&ctl);
+        for (int l = 0; l < NUM_LANES; l++) {
+            if (count_vehicles(&lane_queues[l]) > LANE_DISCARD) {
+                free_lane_queue(&lane_queues[l]);
+                init_lane_queue(&lane_queues[l]);
+            }
+        }
+    }
+    int64_t elapsed = monotonic_ns() - start;
+
+    long long sent = 0, stalls = 0, late = 0;
+    for (int k = 0; k < producers; k++) {
+        sent += atomic_load(&stats[k].sent);
+        stalls += atomic_load(&stats[k].stalls);
+        long long l = atomic_load(&stats[k].late_ns);
+        if (l > late) late = l;
+    }
+    *running = 0;
+    int failed = 0;
+    for (int k = 0; k < producers; k++) {
+        int status;
+        waitpid(pids[k], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = 1;
+    }
+
+    out->sent_per_sec = sent / (elapsed / 1e9);
+    out->ingested_per_sec = ingested / (elapsed / 1e9);
+    out->stalls_per_sec = stalls / (elapsed / 1e9);
+    out->p50_ns = hdr_percentile(&handoff, 50);
+    out->p99_ns = hdr_percentile(&handoff, 99);
+    out->max_late_ms = late / 1e6;
+
+    metrics_destroy(ctl.metrics);
+    munmap(shared, shared_bytes);
+    cleanup_traffic_system();
+    cleanup_queue(ch);
+    destroy_queue();
+    return failed ? -1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    int max_producers = argc > 2 ? atoi(argv[2]) : 8;
+    LoadConfig cfg;
+    load_default_config(&cfg);
+    cfg.rate = argc > 3 ? atof(argv[3]) : 0;
+    cfg.seed = 1;
+    cfg.start_hour = 8; // Rush-hour model starts on the morning peak
+    cfg.platoon_headway_sec = 0; // Platoons as bursts, whatever the rate
+    if (seconds <= 0 || max_producers < 1 || max_producers > LOAD_MAX_PRODUCERS || cfg.rate < 0 ||
+        (argc > 4 && load_parse_model(argv[4], &cfg.model) != 0)) {
+        fprintf(stderr, "usage: %s [seconds] [max_producers 1-%d] [rate, 0 = flat out] [poisson|platoon|rush-hour]\n",
+                argv[0], LOAD_MAX_PRODUCERS);
+        return 1;
+    }
+
+    printf("model,producers,offered_per_sec,sent_per_sec,ingested_per_sec,stalls_per_sec,handoff_p50_ns,handoff_p99_ns,max_late_ms\n");
+    for (int k = 1; k <= max_producers; k = (k * 2 > max_producers && k < max_producers) ? max_producers : k * 2) {
+        IngestResult r;
+        if (run_phase(&cfg, k, seconds, &r) != 0) {
+            fprintf(stderr, "%d producers: run failed\n", k);
+            continue;
+        }
+        printf("%s,%d,%.0f,%.0f,%.0f,%.0f,%lld,%lld,%.1f\n", load_model_name(cfg.model), k, cfg.rate,
+               r.sent_per_sec, r.ingested_per_sec, r.stalls_per_sec, (long long)r.p50_ns, (long long)r.p99_ns,
+               r.max_late_ms);
+        fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+// IPC transport benchmark: POSIX message queue vs shared-memory SPSC rings.
+// A forked producer process pushes vehicles to the controller side, which
+// records the hand-off latency of each one (receive time - sent_ns).
+//
+//   ./bench_ipc [messages]
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include "ipc_manager.h"
+
+#define BATCH 64
+#define PACED_MESSAGES 20000
+#define PACE_NS 20000 // Minimum gap between paced sends
+
+typedef struct {
+    double msgs_per_sec;
+    int64_t p50_ns;
+    int64_t p99_ns;
+    int64_t max_ns;
+} BenchResult;
+
+static const char* transport_name(int t) {
+    return t == TRANSPORT_SHM ? "shm" : "mq";
+}
+
+static void producer(int transport, long count, int paced) {
+    TrafficChannel* ch = join_queue(transport);
+    if (ch == NULL) _exit(1);
+
+    VehicleMessage batch[BATCH];
+    long sent = 0;
+    while (sent < count) {
+        int n = paced ? 1 : (count - sent < BATCH ? (int)(count - sent) : BATCH);
+        for (int i = 0; i < n; i++) {
+            batch[i].id = (int)(sent + i);
+            batch[i].lane = (int)((sent + i) % NUM_LANES);
+            batch[i].type = REGULAR_CAR;
+            batch[i].timestamp = 0;
+        }
+        int done = 0;
+        while (done < n) {
+            int k = send_vehicle_batch(ch, batch + done, n - done);
+            if (k <= 0) sched_yield(); // Full: let the consumer run
+            done += k > 0 ? k : 0;
+        }
+        sent += n;
+        if (paced) usleep(PACE_NS / 1000); // Sleep, so the consumer keeps its CPU
+    }
+    cleanup_queue(ch);
+    _exit(0);
+}
+
+static int cmp_i64(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static int run_phase(int transport, long count, int paced, BenchResult* out) {
+    destroy_queue();
+    TrafficChannel* ch = create_queue(transport);
+    if (ch == NULL) return -1;
+
+    int64_t* lat = malloc(sizeof(int64_t) * count);
+    int64_t start = monotonic_ns();
+    pid_t pid = fork();
+    if (pid == 0) producer(transport, count, paced);
+
+    VehicleMessage batch[BATCH];
+    long got = 0;
+    while (got < count) {
+        int n = receive_vehicle_batch(ch, batch, BATCH);
+        if (n < 0) break;
+        if (n == 0) {
+            sched_yield();
+            continue;
+        }
+        int64_t now = monotonic_ns();
+        for (int i = 0; i < n; i++) lat[got + i] = now - batch[i].sent_ns;
+        got += n;
+    }
+    int64_t elapsed = monotonic_ns() - start;
+
+    int status;
+    waitpid(pid, &status, 0);
+    cleanup_queue(ch);
+    destroy_queue();
+    if (got < count || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        free(lat);
+        return -1;
+    }
+
+    qsort(lat, count, sizeof(int64_t), cmp_i64);
+    out->msgs_per_sec = count / (elapsed / 1e9);
+    out->p50_ns = lat[count / 2];
+    out->p99_ns = lat[(long)(count * 0.99)];
+    out->max_ns = lat[count - 1];
+    free(lat);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    long count = argc > 1 ? atol(argv[1]) : 1000000;
+    if (count <= 0) {
+        fprintf(stderr, "usage: %s [messages]\n", argv[0]);
+        return 1;
+    }
+
+    printf("transport,mode,messages,msgs_per_sec,p50_ns,p99_ns,max_ns\n");
+    int transports[] = { TRANSPORT_MQ, TRANSPORT_SHM };
+    for (int t = 0; t < 2; t++) {
+        BenchResult r;
+        // Saturated: producer publishes as fast as it can, in batches
+        if (run_phase(transports[t], count, 0, &r) == 0) {
+            printf("%s,saturated,%ld,%.0f,%lld,%lld,%lld\n", transport_name(transports[t]), count,
+                   r.msgs_per_sec, (long long)r.p50_ns, (long long)r.p99_ns, (long long)r.max_ns);
+        } else {
+            fprintf(stderr, "%s: saturated run failed\n", transport_name(transports[t]));
+        }
+        // Paced: one message every PACE_NS, so latency excludes queueing
+        if (run_phase(transports[t], PACED_MESSAGES, 1, &r) == 0) {
+            printf("%s,paced,%d,%.0f,%lld,%lld,%lld\n", transport_name(transports[t]), PACED_MESSAGES,
+                   r.msgs_per_sec, (long long)r.p50_ns, (long long)r.p99_ns, (long long)r.max_ns);
+        } else {
+            fprintf(stderr, "%s: paced run failed\n", transport_name(transports[t]));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,188 @@
+#define _GNU_SOURCE // mremap
+#include "checkpoint.h"
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CHECKPOINT_PAGE 4096
+#define CHECKPOINT_LOG_OFFSET CHECKPOINT_PAGE
+#define CHECKPOINT_BASE_BYTES (CHECKPOINT_LOG_OFFSET + CHECKPOINT_LOG_CAPACITY * sizeof(CheckpointEntry))
+
+static CheckpointHeader* header(const Checkpoint* ck) {
+    return (CheckpointHeader*)ck->map;
+}
+
+static CheckpointEntry* log_entries(const Checkpoint* ck) {
+    return (CheckpointEntry*)(ck->map + CHECKPOINT_LOG_OFFSET);
+}
+
+static int64_t wall_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int map_file(Checkpoint* ck, size_t bytes) {
+    void* map = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, ck->fd, 0);
+    if (map == MAP_FAILED) return -1;
+    ck->map = map;
+    ck->map_bytes = bytes;
+    return 0;
+}
+
+int checkpoint_open(Checkpoint* ck, const char* path) {
+    memset(ck, 0, sizeof(*ck));
+    ck->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (ck->fd < 0) return -1;
+    struct stat st;
+    if (fstat(ck->fd, &st) != 0) goto fail;
+
+    if (st.st_size == 0) {
+        if (ftruncate(ck->fd, CHECKPOINT_BASE_BYTES) != 0 || map_file(ck, CHECKPOINT_BASE_BYTES) != 0) goto fail;
+        CheckpointHeader* h = header(ck);
+        h->magic = CHECKPOINT_MAGIC;
+        h->version = CHECKPOINT_VERSION;
+        h->vehicle_size = sizeof(Vehicle);
+        return 0;
+    }
+
+    // Existing checkpoint: refuse anything else rather than overwrite it
+    if ((size_t)st.st_size < CHECKPOINT_BASE_BYTES || map_file(ck, (size_t)st.st_size) != 0) goto fail;
+    CheckpointHeader* h = header(ck);
+    if (h->magic != CHECKPOINT_MAGIC || h->version != CHECKPOINT_VERSION || h->vehicle_size != sizeof(Vehicle)) goto fail;
+    for (int k = 0; k < 2; k++) {
+        if (h->slot_offset[k] + h->slot_bytes[k] > ck->map_bytes) goto fail;
+    }
+    return 0;
+
+fail:
+    if (ck->map) munmap(ck->map, ck->map_bytes);
+    close(ck->fd);
+    ck->map = NULL;
+    return -1;
+}
+
+void checkpoint_close(Checkpoint* ck) {
+    if (ck->map == NULL) return;
+    msync(ck->map, ck->map_bytes, MS_SYNC);
+    munmap(ck->map, ck->map_bytes);
+    close(ck->fd);
+    ck->map = NULL;
+}
+
+// Slots only grow: a larger one moves to the end of the file, with room to spare
+static int reserve_slot(Checkpoint* ck, int slot, size_t need) {
+    CheckpointHeader* h = header(ck);
+    if (h->slot_bytes[slot] >= need) return 0;
+    size_t bytes = (need + need / 2 + CHECKPOINT_PAGE - 1) & ~(size_t)(CHECKPOINT_PAGE - 1);
+    size_t offset = ck->map_bytes;
+    if (ftruncate(ck->fd, (off_t)(offset + bytes)) != 0) return -1;
+    void* map = mremap(ck->map, ck->map_bytes, offset + bytes, MREMAP_MAYMOVE);
+    if (map == MAP_FAILED) return -1;
+    ck->map = map;
+    ck->map_bytes = offset + bytes;
+    h = header(ck);
+    h->slot_offset[slot] = offset;
+    h->slot_bytes[slot] = bytes;
+    return 0;
+}
+
+int checkpoint_save(Checkpoint* ck, const Controller* c, sim_time_t now) {
+    int64_t started = monotonic_ns();
+    size_t total = 0;
+    for (int i = 0; i < NUM_LANES; i++) total += (size_t)count_vehicles(&c->lanes[i]);
+    uint64_t generation = header(ck)->generation + 1;
+    int slot = (int)(generation & 1); // Never the committed one
+    if (reserve_slot(ck, slot, sizeof(CheckpointSnapshot) + total * sizeof(Vehicle)) != 0) {
+        ck->failed++;
+        return -1;
+    }
+
+    CheckpointHeader* h = header(ck);
+    CheckpointSnapshot* snap = (CheckpointSnapshot*)(ck->map + h->slot_offset[slot]);
+    snap->taken_ns = now;
+    snap->taken_wall_ns = wall_ns();
+    controller_save_state(c, &snap->ctl);
+    Vehicle* out = (Vehicle*)(snap + 1);
+    for (int i = 0; i < NUM_LANES; i++) {
+        snap->age_epoch[i] = c->lanes[i].age_epoch;
+        snap->count[i] = peek_vehicles(&c->lanes[i], out, count_vehicles(&c->lanes[i]));
+        out += snap->count[i];
+    }
+
+    // Commit, then retire the log. Until log_generation catches up the old
+    // entries are ignored, since the new snapshot already includes them.
+    atomic_thread_fence(memory_order_release);
+    h->generation = generation;
+    atomic_thread_fence(memory_order_release);
+    h->log_count = 0;
+    h->log_generation = generation;
+    msync(ck->map, ck->map_bytes, MS_ASYNC);
+    ck->snapshots++;
+    int64_t took = monotonic_ns() - started;
+    if (took > ck->max_save_ns) ck->max_save_ns = took;
+    return 0;
+}
+
+int checkpoint_log(Checkpoint* ck, int kind, const Vehicle* v) {
+    CheckpointHeader* h = header(ck);
+    if (h->log_count >= CHECKPOINT_LOG_CAPACITY) {
+        ck->log_lost++;
+        return 1;
+    }
+    CheckpointEntry* e = &log_entries(ck)[h->log_count];
+    e->kind = kind;
+    e->reserved = 0;
+    e->v = *v;
+    atomic_thread_fence(memory_order_release); // The entry lands before the count covers it
+    h->log_count++;
+    return 0;
+}
+
+int checkpoint_restore(Checkpoint* ck, Controller* c, sim_time_t now, CheckpointRestore* out) {
+    memset(out, 0, sizeof(*out));
+    CheckpointHeader* h = header(ck);
+    int have_log = h->log_generation == h->generation && h->log_count > 0;
+    if (h->generation == 0 && !have_log) return 1;
+
+    // The phase resumes with the time it had left; vehicles keep their age
+    // across the downtime (on the same boot the monotonic clock already
+    // covers it and the shift is about zero)
+    sim_time_t age_shift = 0;
+    if (h->generation > 0) {
+        const CheckpointSnapshot* snap = (const CheckpointSnapshot*)(ck->map + h->slot_offset[h->generation & 1]);
+        int64_t downtime = wall_ns() - snap->taken_wall_ns;
+        age_shift = (now - snap->taken_ns) - downtime;
+        out->age_sec = downtime / 1e9;
+        controller_load_state(c, &snap->ctl, now - snap->taken_ns);
+
+        const Vehicle* v = (const Vehicle*)(snap + 1);
+        for (int i = 0; i < NUM_LANES; i++) {
+            c->lanes[i].age_epoch = snap->age_epoch[i]; // Before adding: cars keep their aging
+            for (int k = 0; k < snap->count[i]; k++, v++) {
+                Vehicle copy = *v;
+                copy.arrival_ns += age_shift;
+                add_vehicle(&c->lanes[i], copy);
+            }
+        }
+    }
+
+    for (uint64_t k = 0; have_log && k < h->log_count; k++) {
+        CheckpointEntry* e = &log_entries(ck)[k];
+        if (e->v.lane < 0 || e->v.lane >= NUM_LANES) continue;
+        if (e->kind == CHECKPOINT_ARRIVAL) {
+            Vehicle copy = e->v;
+            copy.arrival_ns += age_shift;
+            add_vehicle(&c->lanes[copy.lane], copy);
+            out->logged_arrivals++;
+        } else if (e->kind == CHECKPOINT_DEPARTURE) {
+            out->logged_departures++;
+            if (controller_forget_crossing(c, e->v.id, now)) continue;
+            if (remove_vehicle_by_id(&c->lanes[e->v.lane], e->v.id).id == -1) out->missing++;
+        }
+    }
+    for (int i = 0; i < NUM_LANES; i++) out->vehicles += count_vehicles(&c->lanes[i]);
+    return 0;
+}
@@ -0,0 +1,88 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include "controller.h"
+
+// Controller checkpoint
+// A memory-mapped file holding the controller's phase state and every
+// queued vehicle, so a restarted controller resumes where it stopped.
+// Snapshots are taken at phase boundaries into the older of two slots and
+// committed by bumping one generation counter, so a crash mid-snapshot
+// leaves the previous one intact. Between snapshots every vehicle taken
+// from the transport and every crossing is appended to a redo log in the
+// same mapping (one record store each), so nothing accepted since the
+// last snapshot is lost and nothing that crossed is served twice. The
+// mapping is MAP_SHARED: a crashed process's writes are already in the
+// page cache, and msync(MS_ASYNC) hands them to the disk in the background.
+#define CHECKPOINT_MAGIC 0x31544B4350525254ULL // "TRTRCPK1"
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_LOG_CAPACITY 65536
+#define CHECKPOINT_LOG_HEADROOM 16384 // Snapshot early once the log gets this close to full
+
+// Redo log record kinds
+#define CHECKPOINT_ARRIVAL 1
+#define CHECKPOINT_DEPARTURE 2
+
+typedef struct {
+    int32_t kind;
+    int32_t reserved;
+    Vehicle v;
+} CheckpointEntry;
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t vehicle_size;       // sizeof(Vehicle) of the writer
+    uint64_t generation;         // Committed snapshots; the latest is in slot generation & 1
+    uint64_t slot_offset[2];
+    uint64_t slot_bytes[2];
+    uint64_t log_generation;     // Snapshot the log entries follow
+    uint64_t log_count;
+} CheckpointHeader;
+
+// Start of a slot; the queued vehicles follow, lane by lane in queue order
+typedef struct {
+    int64_t taken_ns;            // Controller clock
+    int64_t taken_wall_ns;       // CLOCK_REALTIME at the same moment
+    ControllerState ctl;
+    unsigned int age_epoch[NUM_LANES];
+    int32_t count[NUM_LANES];
+} CheckpointSnapshot;
+
+typedef struct {
+    int fd;
+    unsigned char* map;
+    size_t map_bytes;
+    long long snapshots;
+    long long log_lost;          // Log full: entries not recorded (counted, never silent)
+    long long failed;            // Snapshots that could not be written (the previous one stands)
+    int64_t max_save_ns;         // Slowest snapshot so far
+} Checkpoint;
+
+// What checkpoint_restore brought back
+typedef struct {
+    long long vehicles;          // Queued after recovery
+    long long logged_arrivals;   // Replayed from the redo log
+    long long logged_departures;
+    long long missing;           // Logged departures found nowhere (should stay 0)
+    double age_sec;              // Time since the snapshot
+} CheckpointRestore;
+
+int checkpoint_open(Checkpoint* ck, const char* path); // Creates the file or maps an existing one
+void checkpoint_close(Checkpoint* ck);
+
+// Lanes and controller as they are now; resets the redo log. Call at a
+// phase boundary with the lanes' intakes already collected.
+int checkpoint_save(Checkpoint* ck, const Controller* c, sim_time_t now);
+// Redo log (controller thread). Returns 1 if the log was full
+int checkpoint_log(Checkpoint* ck, int kind, const Vehicle* v);
+static inline int checkpoint_log_full(const Checkpoint* ck) {
+    return ((const CheckpointHeader*)ck->map)->log_count + CHECKPOINT_LOG_HEADROOM >= CHECKPOINT_LOG_CAPACITY;
+}
+
+// Latest snapshot plus the redo log into the controller's (empty) lanes,
+// with its phase moved onto the clock at `now`. 1 = nothing to restore
+int checkpoint_restore(Checkpoint* ck, Controller* c, sim_time_t now, CheckpointRestore* out);
+
+#endif
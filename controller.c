@@ -0,0 +1,445 @@
+#include "controller.h"
+#include "traffic_logic.h"
+#include "tracepoint.h"
+
+void controller_default_timing(ControllerTiming* t) {
+    t->green_duration = SIM_SEC(GREEN_DURATION_SEC);
+    t->min_green = SIM_SEC(MIN_GREEN_SEC);
+    t->max_green = SIM_SEC(MAX_GREEN_SEC);
+    t->crossing_time = SIM_USEC(CROSSING_TIME_USEC);
+    t->gap_time = SIM_USEC(GAP_TIME_USEC);
+    t->empty_hold = SIM_USEC(EMPTY_HOLD_USEC);
+    t->all_red = SIM_USEC(ALL_RED_USEC);
+    t->saturation_headway = 0;
+}
+
+void controller_init(Controller* c, LaneQueue* lanes, pthread_mutex_t* lock, const ControllerTiming* timing) {
+    memset(c, 0, sizeof(*c));
+    c->lanes = lanes;
+    c->lock = lock;
+    c->state = PHASE_IDLE;
+    c->current_lane_idx = 0;
+    c->green_mask = 0;
+    c->deadline = SIM_TIME_NEVER;
+    for (int i = 0; i < NUM_LANES; i++) c->crossing[i].id = -1;
+    c->scheduler = &scheduler_fixed;
+    c->conflicts = conflicts_through;
+    if (timing) c->timing = *timing;
+    else controller_default_timing(&c->timing);
+    priority_index_attach(&c->index, lanes, NUM_LANES);
+}
+
+static void lock_lanes(Controller* c) {
+    if (c->lock) TP_LOCK(c->lock, "lanes");
+}
+
+static void unlock_lanes(Controller* c) {
+    if (c->lock) TP_UNLOCK(c->lock, "lanes");
+}
+
+static sim_time_t wait_until(Controller* c, PhaseState state, sim_time_t when) {
+    c->state = state;
+    c->deadline = when;
+    return when;
+}
+
+static void flow_until(Controller* c, int lane, FlowState state, sim_time_t when) {
+    c->flow[lane] = state;
+    c->flow_deadline[lane] = when;
+}
+
+static sim_time_t start_all_red(Controller* c, sim_time_t now) {
+    c->green_mask = 0;
+    return wait_until(c, PHASE_ALL_RED, now + c->timing.all_red);
+}
+
+// The phase ends once every green approach is done; until then the
+// controller wakes for whichever approach's step is due first
+static sim_time_t next_green_deadline(Controller* c, sim_time_t now) {
+    sim_time_t next = SIM_TIME_NEVER;
+    for (LaneMask m = c->green_mask; m; m &= m - 1) {
+        int lane = __builtin_ctz(m);
+        if (c->flow[lane] != FLOW_DONE && c->flow_deadline[lane] < next) next = c->flow_deadline[lane];
+    }
+    if (next == SIM_TIME_NEVER) return start_all_red(c, now);
+    return wait_until(c, PHASE_GREEN, next);
+}
+
+// Released vehicles still waiting for their headway slot at `now`
+static int batch_waiting(const Controller* c, int lane, sim_time_t now) {
+    if (c->batch_count[lane] <= 1) return 0;
+    return c->batch_start[lane] + (c->batch_count[lane] - 1) * c->timing.saturation_headway > now;
+}
+
+// Keep only the vehicles that have entered by `now`; the rest stay queued
+static void truncate_batch(Controller* c, int lane, sim_time_t now) {
+    sim_time_t h = c->timing.saturation_headway;
+    int entered = (int)((now - c->batch_start[lane]) / h) + 1;
+    if (entered >= c->batch_count[lane]) return;
+    c->batch_count[lane] = entered;
+    c->flow_deadline[lane] = c->batch_start[lane] + (entered - 1) * h + c->timing.crossing_time;
+}
+
+// Cut the phase short: approaches between vehicles stop now, any vehicle
+// already in the junction finishes crossing first
+static void stop_green(Controller* c, sim_time_t now) {
+    c->stopping = 1;
+    for (LaneMask m = c->green_mask; m; m &= m - 1) {
+        int lane = __builtin_ctz(m);
+        if (c->flow[lane] != FLOW_CROSSING) c->flow[lane] = FLOW_DONE;
+        else if (batch_waiting(c, lane, now)) truncate_batch(c, lane, now);
+    }
+}
+
+// A normal green only runs while no emergency is waiting, so the earliest
+// waiting emergency of the most urgent class is the one this preemption
+// reacts to (lanes locked). Preemptions by aged cars have no arrival to
+// measure from and are skipped.
+static void record_preemption(Controller* c, sim_time_t now) {
+    Vehicle trigger, v;
+    int found = 0;
+    int cls = priority_index_top_class(&c->index);
+    for (uint32_t m = cls < NUM_EMERGENCY_CLASSES ? c->index.lanes[cls] : 0; m; m &= m - 1) {
+        if (first_emergency_vehicle(&c->lanes[__builtin_ctz(m)], &v) && (!found || v.arrival_ns < trigger.arrival_ns)) {
+            trigger = v;
+            found = 1;
+        }
+    }
+    c->metrics->preemptions++;
+    if (found) metrics_record(c->metrics, METRIC_PREEMPTION_REACTION, &trigger, now - trigger.arrival_ns);
+}
+
+// PREEMPTION CHECK (For Normal Lanes): yield if an emergency is waiting anywhere
+static int should_preempt(Controller* c, sim_time_t now) {
+    if (c->is_emergency_round || c->stopping) return 0;
+    lock_lanes(c);
+    TP_BEGIN("is_any_emergency_active");
+    int emergency_exists = priority_index_top_class(&c->index) <= urgent_class_limit(c->scheduler);
+    if (emergency_exists && c->metrics) record_preemption(c, now);
+    TP_END("is_any_emergency_active");
+    unlock_lanes(c);
+    if (emergency_exists) c->preemptions++;
+    return emergency_exists;
+}
+
+static void record_dequeue(Controller* c, const Vehicle* v, sim_time_t now) {
+    metrics_record(c->metrics, METRIC_QUEUE_WAIT, v, now - v->arrival_ns);
+    if (v->type != REGULAR_CAR) {
+        // Zero if it arrived while its own lane was already green
+        sim_time_t to_green = c->green_start - v->arrival_ns;
+        metrics_record(c->metrics, METRIC_EMERGENCY_TO_GREEN, v, to_green > 0 ? to_green : 0);
+    }
+}
+
+// Saturation flow: every vehicle that can enter before the green ends, one
+// per headway, released at once. They stay queued (at the stop line) until
+// the batch has crossed, so a preemption can still hold back the ones that
+// have not entered yet.
+static void release_batch(Controller* c, int lane, sim_time_t now) {
+    sim_time_t h = c->timing.saturation_headway;
+    sim_time_t left = c->green_start + c->green_time - now;
+    int want = (int)((left + h - 1) / h);
+    if (want < 1) want = 1;
+    if (want > DISCHARGE_BATCH_MAX) want = DISCHARGE_BATCH_MAX;
+
+    Vehicle head[DISCHARGE_BATCH_MAX];
+    lock_lanes(c);
+    int n = peek_vehicles(&c->lanes[lane], head, want);
+    unlock_lanes(c);
+    int released = 0;
+    while (released < n && head[released].type == REGULAR_CAR) released++;
+
+    if (released == 0) {
+        flow_until(c, lane, FLOW_EMPTY, now + c->timing.empty_hold);
+        return;
+    }
+    c->crossing[lane] = head[0];
+    c->batch_count[lane] = released;
+    c->batch_start[lane] = now;
+    flow_until(c, lane, FLOW_CROSSING, now + (released - 1) * h + c->timing.crossing_time);
+}
+
+// One pass of the green light timer loop for one green approach
+static void green_step(Controller* c, int lane, sim_time_t now) {
+    if (c->stopping || (!c->is_emergency_round && now - c->green_start >= c->green_time)) {
+        c->flow[lane] = FLOW_DONE;
+        return;
+    }
+
+    if (should_preempt(c, now)) {
+        stop_green(c, now);
+        return;
+    }
+
+    if (c->timing.saturation_headway > 0 && !c->is_emergency_round) {
+        release_batch(c, lane, now);
+        return;
+    }
+
+    // Check if vehicles exist in this approach
+    Vehicle v_crossing = { -1 };
+    lock_lanes(c);
+    if (count_vehicles(&c->lanes[lane]) > 0) {
+        v_crossing = remove_vehicle(&c->lanes[lane]);
+        // Apply Aging to others
+        TP_BEGIN("handle_aging");
+        for (int i = 0; i < NUM_LANES; i++) handle_aging(&c->lanes[i]);
+        TP_END("handle_aging");
+    }
+    unlock_lanes(c);
+
+    if (v_crossing.id == -1) {
+        flow_until(c, lane, FLOW_EMPTY, now + c->timing.empty_hold);
+        return;
+    }
+    if (c->metrics) record_dequeue(c, &v_crossing, now);
+    c->crossing[lane] = v_crossing;
+    flow_until(c, lane, FLOW_CROSSING, now + c->timing.crossing_time);
+}
+
+// The whole batch leaves the lane in one locked operation and is handed to
+// metrics and the crossing hook with each vehicle's own entry/exit stamps
+static void finish_batch(Controller* c, int lane, sim_time_t now) {
+    Vehicle done[DISCHARGE_BATCH_MAX];
+    sim_time_t h = c->timing.saturation_headway;
+    lock_lanes(c);
+    int n = remove_head_vehicles(&c->lanes[lane], done, c->batch_count[lane]);
+    TP_BEGIN("handle_aging");
+    for (int i = 0; i < NUM_LANES; i++) handle_aging_by(&c->lanes[i], n);
+    TP_END("handle_aging");
+    unlock_lanes(c);
+    c->batch_count[lane] = 0;
+    c->crossing[lane].id = -1;
+
+    for (int i = 0; i < n; i++) {
+        sim_time_t entered = c->batch_start[lane] + i * h;
+        if (c->metrics) record_dequeue(c, &done[i], entered);
+        metrics_count_crossing(c->metrics, &done[i]);
+        if (c->on_crossed) c->on_crossed(c->hook_ctx, &done[i], entered + c->timing.crossing_time);
+    }
+
+    if (c->stopping) {
+        c->flow[lane] = FLOW_DONE;
+        return;
+    }
+    if (should_preempt(c, now)) {
+        c->flow[lane] = FLOW_DONE;
+        stop_green(c, now);
+        return;
+    }
+    green_step(c, lane, now); // Saturation flow: no gap between batches
+}
+
+static void finish_crossing(Controller* c, int lane, sim_time_t now) {
+    if (c->batch_count[lane] > 0) {
+        finish_batch(c, lane, now);
+        return;
+    }
+    Vehicle v = c->crossing[lane];
+    c->crossing[lane].id = -1;
+    metrics_count_crossing(c->metrics, &v);
+    if (c->on_crossed) c->on_crossed(c->hook_ctx, &v, now);
+    // Emergency rounds serve one vehicle per approach, then rotate
+    if (c->is_emergency_round || c->stopping) {
+        c->flow[lane] = FLOW_DONE;
+        return;
+    }
+    // Don't sit through the gap if an emergency arrived mid-crossing
+    if (should_preempt(c, now)) {
+        c->flow[lane] = FLOW_DONE;
+        stop_green(c, now);
+        return;
+    }
+
+    // The gap ends early if the green expires during it
+    sim_time_t next = now + c->timing.gap_time;
+    sim_time_t green_end = c->green_start + c->green_time;
+    flow_until(c, lane, FLOW_GAP, next < green_end ? next : green_end);
+}
+
+static sim_time_t begin_phase(Controller* c, sim_time_t now) {
+    LaneEstimate est[NUM_LANES];
+    if (c->sensors) {
+        for (int i = 0; i < NUM_LANES; i++) sensor_read(&c->sensors[i], &est[i]);
+    }
+    sim_time_t headway = c->timing.saturation_headway > 0 ? c->timing.saturation_headway
+                                                          : c->timing.crossing_time + c->timing.gap_time;
+    GreenLimits lim = { c->timing.green_duration, c->timing.min_green, c->timing.max_green, headway };
+
+    lock_lanes(c);
+    // Emergencies straight from the index; the policy only sees normal lanes
+    TP_BEGIN("select_next_lane");
+    int urgent = urgent_class_limit(c->scheduler);
+    int next_lane = priority_index_next(&c->index, c->current_lane_idx, urgent);
+    if (next_lane == -1) next_lane = c->scheduler->next_lane(c->lanes, c->current_lane_idx, c->sensors ? est : NULL);
+    TP_END("select_next_lane");
+    if (next_lane == -1) {
+        unlock_lanes(c);
+        c->green_mask = 0;
+        return wait_until(c, PHASE_IDLE, SIM_TIME_NEVER);
+    }
+
+    // Compatible approaches join the lead: emergency rounds only take
+    // other emergency approaches, normal rounds any approach with traffic
+    c->current_lane_idx = next_lane;
+    c->is_emergency_round = c->index.top[next_lane] <= urgent;
+    LaneMask candidates = 0;
+    for (int cls = 0; cls <= (c->is_emergency_round ? urgent : CLASS_CAR); cls++) candidates |= c->index.lanes[cls];
+    c->green_mask = compatible_phase(c->conflicts, next_lane, candidates);
+    if (!c->is_emergency_round) {
+        c->green_time = 0;
+        for (LaneMask m = c->green_mask; m; m &= m - 1) {
+            sim_time_t t = c->scheduler->green_time(c->lanes, __builtin_ctz(m), c->sensors ? est : NULL, &lim);
+            if (t > c->green_time) c->green_time = t;
+        }
+    }
+    unlock_lanes(c);
+
+    c->stopping = 0;
+    c->green_start = now;
+    c->phases++;
+    if (c->metrics) c->metrics->phases++;
+    for (LaneMask m = c->green_mask; m; m &= m - 1) {
+        int lane = __builtin_ctz(m);
+        c->flow[lane] = FLOW_GAP;
+        green_step(c, lane, now);
+    }
+    return next_green_deadline(c, now);
+}
+
+// Runs every decision due at `now` and returns the next deadline
+// (SIM_TIME_NEVER while idle; the driver re-advances on the next arrival).
+sim_time_t controller_advance(Controller* c, sim_time_t now) {
+    if (c->state != PHASE_GREEN) return begin_phase(c, now);
+
+    // Approaches step in lane order, so simultaneous deadlines are deterministic
+    for (LaneMask m = c->green_mask; m; m &= m - 1) {
+        int lane = __builtin_ctz(m);
+        if (c->flow[lane] == FLOW_DONE || c->flow_deadline[lane] > now) continue;
+        switch (c->flow[lane]) {
+            case FLOW_CROSSING:
+                finish_crossing(c, lane, now);
+                break;
+            case FLOW_GAP:
+                green_step(c, lane, now);
+                break;
+            case FLOW_EMPTY:
+            default:
+                c->flow[lane] = FLOW_DONE;
+                break;
+        }
+    }
+    return next_green_deadline(c, now);
+}
+
+// Vehicles were queued at `now`. Starts a phase if idle and preempts a
+// normal green (between vehicles) the moment an emergency shows up,
+// instead of waiting for the next deadline. Returns 1 if the deadline changed.
+int controller_on_arrival(Controller* c, sim_time_t now) {
+    sim_time_t before = c->deadline;
+    PhaseState state = c->state;
+
+    if (c->state == PHASE_IDLE) {
+        begin_phase(c, now);
+    } else if (c->state == PHASE_GREEN) {
+        int between_vehicles = 0;
+        for (LaneMask m = c->green_mask; m; m &= m - 1) {
+            int lane = __builtin_ctz(m);
+            FlowState f = c->flow[lane];
+            if (f == FLOW_GAP || f == FLOW_EMPTY || batch_waiting(c, lane, now)) between_vehicles = 1;
+        }
+        if (between_vehicles && should_preempt(c, now)) {
+            stop_green(c, now);
+            next_green_deadline(c, now);
+        }
+    }
+    return c->deadline != before || c->state != state;
+}
+
+// Moves everything submitted to the intakes into the lanes. Call from the
+// thread that owns the lanes, then controller_on_arrival if anything moved.
+int controller_collect_arrivals(Controller* c) {
+    if (c->intake == NULL) return 0;
+    int moved = 0;
+    Vehicle v;
+    lock_lanes(c);
+    for (int i = 0; i < NUM_LANES; i++) {
+        while (lane_intake_pop(&c->intake[i], &v) == 0) {
+            add_vehicle(&c->lanes[i], v);
+            metrics_count_arrival(c->metrics, &v);
+            moved++;
+        }
+    }
+    unlock_lanes(c);
+    return moved;
+}
+
+void controller_journal_entry(const Controller* c, const Vehicle* v, sim_time_t now, JournalRecord* out) {
+    memset(out, 0, sizeof(*out));
+    out->id = v->id;
+    out->type = (uint8_t)v->type;
+    out->lane = (uint8_t)v->lane;
+    out->arrival_ns = v->arrival_ns;
+    out->green_ns = c->green_start;
+    out->crossed_ns = now;
+    if (c->is_emergency_round) out->flags |= JOURNAL_EMERGENCY_ROUND;
+    if (c->stopping) out->flags |= JOURNAL_PREEMPTED;
+}
+
+void controller_save_state(const Controller* c, ControllerState* out) {
+    memset(out, 0, sizeof(*out));
+    out->state = c->state;
+    out->current_lane_idx = c->current_lane_idx;
+    out->green_mask = c->green_mask;
+    out->is_emergency_round = c->is_emergency_round;
+    out->stopping = c->stopping;
+    out->green_start = c->green_start;
+    out->green_time = c->green_time;
+    out->deadline = c->deadline;
+    memcpy(out->flow, c->flow, sizeof(out->flow));
+    memcpy(out->flow_deadline, c->flow_deadline, sizeof(out->flow_deadline));
+    memcpy(out->crossing, c->crossing, sizeof(out->crossing));
+    memcpy(out->batch_count, c->batch_count, sizeof(out->batch_count));
+    memcpy(out->batch_start, c->batch_start, sizeof(out->batch_start));
+    out->phases = c->phases;
+    out->preemptions = c->preemptions;
+}
+
+static sim_time_t shift_time(sim_time_t t, sim_time_t shift) {
+    return t == SIM_TIME_NEVER ? t : t + shift;
+}
+
+void controller_load_state(Controller* c, const ControllerState* s, sim_time_t shift) {
+    c->state = s->state;
+    c->current_lane_idx = s->current_lane_idx;
+    c->green_mask = s->green_mask;
+    c->is_emergency_round = s->is_emergency_round;
+    c->stopping = s->stopping;
+    c->green_start = s->green_start + shift;
+    c->green_time = s->green_time;
+    c->deadline = shift_time(s->deadline, shift);
+    for (int i = 0; i < NUM_LANES; i++) {
+        c->flow[i] = s->flow[i];
+        c->flow_deadline[i] = shift_time(s->flow_deadline[i], shift);
+        c->crossing[i] = s->crossing[i];
+        c->batch_count[i] = s->batch_count[i];
+        c->batch_start[i] = s->batch_start[i] + shift;
+    }
+    c->phases = s->phases;
+    c->preemptions = s->preemptions;
+}
+
+int controller_forget_crossing(Controller* c, int id, sim_time_t now) {
+    for (LaneMask m = c->green_mask; m; m &= m - 1) {
+        int lane = __builtin_ctz(m);
+        if (c->flow[lane] != FLOW_CROSSING || c->crossing[lane].id != id) continue;
+        int queued = c->batch_count[lane] > 0; // A batch leaves the lane when it has crossed
+        c->batch_count[lane] = 0;
+        c->crossing[lane].id = -1;
+        // As after finish_crossing: emergency rounds and stopped greens are done
+        flow_until(c, lane, c->is_emergency_round || c->stopping ? FLOW_DONE : FLOW_GAP, now);
+        next_green_deadline(c, now);
+        return !queued;
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+#ifndef CONTROLLER_H
+#define CONTROLLER_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "utils.h"
+#include "metrics.h"
+#include "lane_intake.h"
+#include "traffic_logic.h"
+#include "journal.h"
+
+// Controller clock: nanoseconds, either virtual (headless) or monotonic (live)
+typedef int64_t sim_time_t;
+#define SIM_TIME_NEVER INT64_MAX
+#define SIM_USEC(x) ((sim_time_t)(x) * 1000LL)
+#define SIM_MSEC(x) ((sim_time_t)(x) * 1000000LL)
+#define SIM_SEC(x) ((sim_time_t)(x) * 1000000000LL)
+
+// Phase Timing (defaults match the interactive controller)
+#define GREEN_DURATION_SEC 8
+#define MIN_GREEN_SEC 4            // Adaptive schedulers: shortest normal green
+#define MAX_GREEN_SEC 30           // Adaptive schedulers: longest normal green
+#define CROSSING_TIME_USEC 1500000 // 1.5s per car
+#define GAP_TIME_USEC 200000       // Pause between cars on the same green
+#define EMPTY_HOLD_USEC 500000     // Hold after the green lane drains
+#define ALL_RED_USEC 1000000       // All red safety interval
+#define DISCHARGE_BATCH_MAX 64     // Vehicles released per batch at most
+
+typedef enum {
+    PHASE_IDLE,     // All lanes empty, waiting for an arrival
+    PHASE_GREEN,    // One or more compatible approaches discharging
+    PHASE_ALL_RED   // Yellow/Red transition between phases
+} PhaseState;
+
+// What each green approach is doing; they run side by side within a phase
+typedef enum {
+    FLOW_CROSSING, // One vehicle from this approach in the junction
+    FLOW_GAP,      // Brief pause before its next vehicle
+    FLOW_EMPTY,    // Approach drained, holding before the switch
+    FLOW_DONE      // Finished for this phase
+} FlowState;
+
+typedef struct {
+    sim_time_t green_duration;
+    sim_time_t min_green;
+    sim_time_t max_green;
+    sim_time_t crossing_time;
+    sim_time_t gap_time;
+    sim_time_t empty_hold;
+    sim_time_t all_red;
+    sim_time_t saturation_headway; // Batch discharge: one vehicle enters every headway (0 = one at a time)
+} ControllerTiming;
+
+// Called when a vehicle has finished crossing the junction
+typedef void (*CrossingHook)(void* ctx, const Vehicle* v, sim_time_t now);
+
+// One intersection's phase state machine. It owns no clock: the driver
+// calls controller_advance() whenever the returned deadline is reached.
+typedef struct {
+    LaneQueue* lanes;       // NUM_LANES approaches served by this controller
+    pthread_mutex_t* lock;  // Guards lanes; NULL when the driver thread owns them
+    LaneIntake* intake;     // Optional per-lane intakes fed by other threads
+    PhaseState state;
+    int current_lane_idx;   // Round Robin position (the phase's lead approach)
+    LaneMask green_mask;    // Approaches green together (0 = all red)
+    int is_emergency_round; // Serve 1 vehicle per approach then rotate
+    int stopping;           // Phase cut short: green approaches take no new vehicle
+    sim_time_t green_start;
+    sim_time_t green_time;  // Length of the current normal green
+    sim_time_t deadline;    // Earliest pending step
+    FlowState flow[NUM_LANES];           // Valid for approaches in green_mask
+    sim_time_t flow_deadline[NUM_LANES];
+    Vehicle crossing[NUM_LANES];         // id -1 unless that approach is in FLOW_CROSSING (batch: the lead)
+    int batch_count[NUM_LANES];          // Batch released, still queued until it has crossed (0 = none)
+    sim_time_t batch_start[NUM_LANES];
+    const LaneMask* conflicts;           // Conflict matrix (default conflicts_through)
+    ControllerTiming timing;
+    const SchedulerPolicy* scheduler; // Normal green policy (default: fixed)
+    const LaneSensor* sensors;        // Optional per-lane demand estimates for the policy
+    PriorityIndex index;              // Lanes by most urgent class, kept current by the lanes themselves
+
+    CrossingHook on_crossed;
+    void* hook_ctx;
+    Metrics* metrics;       // Optional latency/throughput recording (NULL = off)
+
+    // Counters
+    long long phases;
+    long long preemptions;
+} Controller;
+
+// Phase state without the wiring (lanes, hooks, policy), for checkpoints
+typedef struct {
+    PhaseState state;
+    int current_lane_idx;
+    LaneMask green_mask;
+    int is_emergency_round;
+    int stopping;
+    sim_time_t green_start;
+    sim_time_t green_time;
+    sim_time_t deadline;
+    FlowState flow[NUM_LANES];
+    sim_time_t flow_deadline[NUM_LANES];
+    Vehicle crossing[NUM_LANES];
+    int batch_count[NUM_LANES];
+    sim_time_t batch_start[NUM_LANES];
+    long long phases;
+    long long preemptions;
+} ControllerState;
+
+void controller_default_timing(ControllerTiming* t);
+// Attaches the lanes to the controller's priority index: the controller
+// must stay put while they are in use
+void controller_init(Controller* c, LaneQueue* lanes, pthread_mutex_t* lock, const ControllerTiming* timing);
+sim_time_t controller_advance(Controller* c, sim_time_t now);
+int controller_on_arrival(Controller* c, sim_time_t now);
+int controller_collect_arrivals(Controller* c); // Intake -> lanes; returns vehicles moved
+void controller_save_state(const Controller* c, ControllerState* out);
+// Resumes a saved phase; `shift` moves its times onto the current clock
+void controller_load_state(Controller* c, const ControllerState* s, sim_time_t shift);
+// Vehicle `id` is known to have crossed since the state was saved: frees
+// its approach at `now`. Returns 1 if it was only in the junction, 0 if it
+// is still queued (not crossing, or the lead of a batch).
+int controller_forget_crossing(Controller* c, int id, sim_time_t now);
+// Journal entry for a vehicle the on_crossed hook is reporting (call from the hook)
+void controller_journal_entry(const Controller* c, const Vehicle* v, sim_time_t now, JournalRecord* out);
+
+#endif
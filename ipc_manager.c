@@ -1,8 +1,37 @@
 #include "ipc_manager.h"
 #include <stdio.h>
 #include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
 
-mqd_t create_queue() {
+static TrafficChannel* new_channel(int transport) {
+    TrafficChannel* ch = (TrafficChannel*)calloc(1, sizeof(TrafficChannel));
+    ch->transport = transport;
+    ch->mq = (mqd_t)-1;
+    return ch;
+}
+
+static size_t shm_ring_stride() {
+    size_t bytes = spsc_ring_bytes(SHM_RING_CAPACITY, sizeof(VehicleMessage));
+    return (bytes + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1);
+}
+
+static size_t shm_segment_bytes() {
+    return sizeof(ShmHeader) + SHM_MAX_PRODUCERS * shm_ring_stride();
+}
+
+static SpscRing* shm_ring(ShmHeader* h, int slot) {
+    return (SpscRing*)(h->rings + (size_t)slot * h->ring_bytes);
+}
+
+static ShmHeader* map_segment(int fd, size_t bytes) {
+    void* p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return p == MAP_FAILED ? NULL : (ShmHeader*)p;
+}
+
+static TrafficChannel* create_mq_channel() {
     struct mq_attr attr;
     attr.mq_flags = 0;
     attr.mq_maxmsg = MAX_MQ_MSGS;
@@ -17,43 +46,240 @@ mqd_t create_queue() {
         mq = mq_open(QUEUE_NAME, O_CREAT | O_RDWR | O_NONBLOCK, 0644, &attr);
         if (mq == (mqd_t)-1) {
              perror("mq_open (re-create) failed");
+             return NULL;
         }
     }
-    return mq;
+    TrafficChannel* ch = new_channel(TRANSPORT_MQ);
+    ch->mq = mq;
+    return ch;
 }
 
-mqd_t join_queue() {
-    mqd_t mq = mq_open(QUEUE_NAME, O_WRONLY); // Vehicles only write
-    if (mq == (mqd_t)-1) {
-        perror("mq_open (join) failed");
+// A segment left by a controller that died keeps whatever its producers
+// had published; take those vehicles over before the segment goes
+static void salvage_segment(TrafficChannel* ch) {
+    int fd = shm_open(SHM_NAME, O_RDWR, 0);
+    if (fd == -1) return;
+    size_t bytes = shm_segment_bytes();
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size != bytes) {
+        close(fd);
+        return;
+    }
+    ShmHeader* h = map_segment(fd, bytes);
+    if (h == NULL) return;
+    if (h->magic == SHM_MAGIC && h->ring_bytes == shm_ring_stride()) {
+        int producers = atomic_load(&h->producers);
+        if (producers > SHM_MAX_PRODUCERS) producers = SHM_MAX_PRODUCERS;
+        size_t pending = 0;
+        for (int i = 0; i < producers; i++) pending += spsc_ring_size(shm_ring(h, i));
+        ch->salvaged = pending ? malloc(pending * sizeof(VehicleMessage)) : NULL;
+        for (int i = 0; ch->salvaged && i < producers; i++) {
+            SpscRing* r = shm_ring(h, i);
+            ch->salvaged_count += (int)spsc_ring_pop_batch(r, ch->salvaged + ch->salvaged_count, pending - ch->salvaged_count);
+        }
+    }
+    munmap(h, bytes);
+}
+
+static TrafficChannel* create_shm_channel() {
+    TrafficChannel* ch = new_channel(TRANSPORT_SHM);
+    salvage_segment(ch);
+    // Then start from a fresh segment so no stale producer slots survive
+    shm_unlink(SHM_NAME);
+    int fd = shm_open(SHM_NAME, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd == -1) {
+        perror("shm_open (create) failed");
+        cleanup_queue(ch);
+        return NULL;
+    }
+    size_t bytes = shm_segment_bytes();
+    if (ftruncate(fd, bytes) == -1) {
+        perror("ftruncate failed");
+        close(fd);
+        cleanup_queue(ch);
+        return NULL;
+    }
+    ShmHeader* h = map_segment(fd, bytes);
+    if (h == NULL) {
+        perror("mmap (create) failed");
+        cleanup_queue(ch);
+        return NULL;
+    }
+
+    h->ring_bytes = (uint32_t)shm_ring_stride();
+    atomic_init(&h->producers, 0);
+    atomic_init(&h->consumer_waiting, 0);
+    h->notify_fd = eventfd(0, EFD_NONBLOCK);
+    if (h->notify_fd == -1) {
+        perror("eventfd failed");
+        munmap(h, bytes);
+        cleanup_queue(ch);
+        return NULL;
+    }
+    for (int i = 0; i < SHM_MAX_PRODUCERS; i++) {
+        spsc_ring_init(shm_ring(h, i), SHM_RING_CAPACITY, sizeof(VehicleMessage));
+    }
+    h->magic = SHM_MAGIC;
+
+    ch->shm = h;
+    ch->shm_bytes = bytes;
+    return ch;
+}
+
+TrafficChannel* create_queue(int transport) {
+    return transport == TRANSPORT_SHM ? create_shm_channel() : create_mq_channel();
+}
+
+TrafficChannel* join_queue(int transport) {
+    if (transport == TRANSPORT_MQ) {
+        mqd_t mq = mq_open(QUEUE_NAME, O_WRONLY); // Vehicles only write
+        if (mq == (mqd_t)-1) {
+            perror("mq_open (join) failed");
+            return NULL;
+        }
+        TrafficChannel* ch = new_channel(TRANSPORT_MQ);
+        ch->mq = mq;
+        return ch;
+    }
+
+    int fd = shm_open(SHM_NAME, O_RDWR, 0);
+    if (fd == -1) {
+        perror("shm_open (join) failed");
+        return NULL;
+    }
+    size_t bytes = shm_segment_bytes();
+    ShmHeader* h = map_segment(fd, bytes);
+    if (h == NULL || h->magic != SHM_MAGIC) {
+        fprintf(stderr, "shm join failed: segment not initialised\n");
+        if (h) munmap(h, bytes);
+        return NULL;
+    }
+
+    // Claim a ring of our own: each ring has exactly one producer
+    int slot = atomic_fetch_add(&h->producers, 1);
+    if (slot >= SHM_MAX_PRODUCERS) {
+        fprintf(stderr, "shm join failed: more than %d producers\n", SHM_MAX_PRODUCERS);
+        munmap(h, bytes);
+        return NULL;
+    }
+    TrafficChannel* ch = new_channel(TRANSPORT_SHM);
+    ch->shm = h;
+    ch->shm_bytes = bytes;
+    ch->ring = shm_ring(h, slot);
+    return ch;
+}
+
+// Publish, then check the flag: pairs with queue_prepare_wait, which raises
+// the flag, then checks the rings. Either we see the flag or it sees our data.
+static void wake_consumer(ShmHeader* h) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&h->consumer_waiting, memory_order_relaxed) &&
+        atomic_exchange(&h->consumer_waiting, 0)) {
+        uint64_t one = 1;
+        if (write(h->notify_fd, &one, sizeof(one)) < 0) { /* Counter saturated: already signalled */ }
     }
-    return mq;
 }
 
-int send_vehicle_msg(mqd_t mq, VehicleMessage* msg) {
-    if (mq_send(mq, (const char*)msg, sizeof(VehicleMessage), 0) == -1) {
+int send_vehicle_batch(TrafficChannel* ch, VehicleMessage* msgs, int count) {
+    int64_t now = monotonic_ns();
+    for (int i = 0; i < count; i++) msgs[i].sent_ns = now;
+
+    if (ch->transport == TRANSPORT_SHM) {
+        int sent = (int)spsc_ring_push_batch(ch->ring, msgs, count);
+        if (sent > 0) wake_consumer(ch->shm);
+        return sent;
+    }
+    int sent = 0;
+    while (sent < count && mq_send(ch->mq, (const char*)&msgs[sent], sizeof(VehicleMessage), 0) == 0) sent++;
+    return sent;
+}
+
+int send_vehicle_msg(TrafficChannel* ch, VehicleMessage* msg) {
+    if (send_vehicle_batch(ch, msg, 1) == 1) return 0;
+    if (ch->transport == TRANSPORT_SHM) {
+        errno = EAGAIN;
+        perror("shm send failed");
+    } else {
         perror("mq_send failed");
-        return -1;
     }
-    return 0;
+    return -1;
 }
 
-int receive_vehicle_msg(mqd_t mq, VehicleMessage* msg) {
-    ssize_t bytes_read = mq_receive(mq, (char*)msg, MAX_MSG_SIZE, NULL);
-    if (bytes_read >= 0) {
-        return 0; // Success
+int receive_vehicle_batch(TrafficChannel* ch, VehicleMessage* msgs, int max) {
+    int got = 0;
+    while (got < max && ch->salvaged_next < ch->salvaged_count) msgs[got++] = ch->salvaged[ch->salvaged_next++];
+    if (got == max) return got;
+    if (ch->transport == TRANSPORT_SHM) {
+        int producers = atomic_load_explicit(&ch->shm->producers, memory_order_acquire);
+        if (producers > SHM_MAX_PRODUCERS) producers = SHM_MAX_PRODUCERS;
+        // Round robin start so one busy producer cannot starve the others
+        for (int k = 0; k < producers && got < max; k++) {
+            int slot = (ch->next_ring + k) % producers;
+            got += (int)spsc_ring_pop_batch(shm_ring(ch->shm, slot), msgs + got, max - got);
+        }
+        if (producers > 0) ch->next_ring = (ch->next_ring + 1) % producers;
+        return got;
     }
-    if (errno == EAGAIN) {
-        return 1; // Empty
+    while (got < max && mq_receive(ch->mq, (char*)&msgs[got], MAX_MSG_SIZE, NULL) >= 0) got++;
+    if (got == 0 && errno != EAGAIN) {
+        perror("mq_receive failed");
+        return -1;
     }
-    perror("mq_receive failed");
+    return got;
+}
+
+int receive_vehicle_msg(TrafficChannel* ch, VehicleMessage* msg) {
+    int got = receive_vehicle_batch(ch, msg, 1);
+    if (got == 1) return 0; // Success
+    if (got == 0) return 1; // Empty
     return -1; // Error
 }
 
-void cleanup_queue(mqd_t mq) {
-    mq_close(mq);
+int queue_notify_fd(TrafficChannel* ch) {
+    return ch->transport == TRANSPORT_SHM ? ch->shm->notify_fd : (int)ch->mq; // mqd_t is a descriptor on Linux
+}
+
+int queue_prepare_wait(TrafficChannel* ch) {
+    if (ch->salvaged_next < ch->salvaged_count) return 0;
+    if (ch->transport != TRANSPORT_SHM) return 1; // Level-triggered: the fd is readable while messages wait
+    ShmHeader* h = ch->shm;
+    atomic_store(&h->consumer_waiting, 1);
+    int producers = atomic_load(&h->producers);
+    if (producers > SHM_MAX_PRODUCERS) producers = SHM_MAX_PRODUCERS;
+    for (int i = 0; i < producers; i++) {
+        if (spsc_ring_size(shm_ring(h, i)) > 0) {
+            atomic_store(&h->consumer_waiting, 0);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void queue_ack_notify(TrafficChannel* ch) {
+    if (ch->transport != TRANSPORT_SHM) return;
+    uint64_t count;
+    if (read(ch->shm->notify_fd, &count, sizeof(count)) < 0) { /* Already drained */ }
+}
+
+void cleanup_queue(TrafficChannel* ch) {
+    if (ch == NULL) return;
+    if (ch->transport == TRANSPORT_SHM) {
+        if (ch->shm != NULL) {
+            if (ch->ring == NULL) close(ch->shm->notify_fd); // Creator owns the eventfd
+            munmap(ch->shm, ch->shm_bytes);
+        }
+    } else {
+        mq_close(ch->mq);
+    }
+    free(ch->salvaged);
+    free(ch);
+}
+
+int queue_salvaged(const TrafficChannel* ch) {
+    return ch->salvaged_count;
 }
 
 void destroy_queue() {
     mq_unlink(QUEUE_NAME);
+    shm_unlink(SHM_NAME);
 }
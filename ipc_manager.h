@@ -5,24 +5,70 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include "utils.h"
+#include "spsc_ring.h"
 
 #define QUEUE_NAME "/traffic_mq"
 #define MAX_MSG_SIZE sizeof(VehicleMessage)
 #define MAX_MQ_MSGS 10
 
+// Shared-memory transport: one SPSC ring per producer, all in one segment
+#define SHM_NAME "/traffic_shm"
+#define SHM_MAGIC 0x54524646 // "TRFF"
+#define SHM_MAX_PRODUCERS 16
+#define SHM_RING_CAPACITY 4096
+
+// Transports
+#define TRANSPORT_MQ 0  // POSIX message queue: one syscall per vehicle
+#define TRANSPORT_SHM 1 // shm_open/mmap SPSC rings: no syscalls on the hot path
+
 typedef struct {
     int id;
     int lane; // 0=N, 1=S, 2=E, 3=W
     int type; // Vehicle Type
     time_t timestamp;
+    int64_t sent_ns; // CLOCK_MONOTONIC when handed to the transport
 } VehicleMessage;
 
+// Layout of the shared segment
+typedef struct {
+    uint32_t magic;
+    uint32_t ring_bytes;        // Stride between rings
+    atomic_int producers;       // Rings claimed so far
+    // Wakeups: the consumer raises consumer_waiting before it sleeps and a
+    // producer only pays for the eventfd write when it sees the flag.
+    // notify_fd is the creator's eventfd, valid in processes forked from it.
+    int notify_fd;
+    _Alignas(CACHE_LINE) atomic_int consumer_waiting;
+    _Alignas(CACHE_LINE) unsigned char rings[]; // SHM_MAX_PRODUCERS rings
+} ShmHeader;
+
+// Endpoint handle: the controller's (create) or one producer's (join)
+typedef struct {
+    int transport;
+    mqd_t mq;
+    ShmHeader* shm;
+    size_t shm_bytes;
+    SpscRing* ring;     // Producer: its own ring
+    int next_ring;      // Consumer: round-robin position
+    VehicleMessage* salvaged; // Consumer: still in flight in a crashed run's segment, delivered first
+    int salvaged_count;
+    int salvaged_next;
+} TrafficChannel;
+
 // Function Prototypes
-mqd_t create_queue();
-mqd_t join_queue();
-int send_vehicle_msg(mqd_t mq, VehicleMessage* msg);
-int receive_vehicle_msg(mqd_t mq, VehicleMessage* msg);
-void cleanup_queue(mqd_t mq);
+TrafficChannel* create_queue(int transport);
+TrafficChannel* join_queue(int transport);
+int send_vehicle_msg(TrafficChannel* ch, VehicleMessage* msg);
+int receive_vehicle_msg(TrafficChannel* ch, VehicleMessage* msg);
+int send_vehicle_batch(TrafficChannel* ch, VehicleMessage* msgs, int count); // Returns number sent
+int receive_vehicle_batch(TrafficChannel* ch, VehicleMessage* msgs, int max); // Returns number received
+void cleanup_queue(TrafficChannel* ch);
+
+// Event-driven consumers: poll queue_notify_fd() for arrivals
+int queue_notify_fd(TrafficChannel* ch);
+int queue_prepare_wait(TrafficChannel* ch); // 1 = nothing pending, safe to sleep
+void queue_ack_notify(TrafficChannel* ch);  // After the fd fired
+int queue_salvaged(const TrafficChannel* ch); // Vehicles recovered from a previous run's segment
 void destroy_queue();
 
 #endif
@@ -0,0 +1,165 @@
+#include "journal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include "utils.h"
+
+static const char* lane_names[NUM_LANES] = { "NORTH", "SOUTH", "EAST", "WEST" };
+static const char* type_names[NUM_VEHICLE_TYPES] = { "CAR", "AMBULANCE", "POLICE", "FIRE_TRUCK" };
+
+// ---------------- Writer ----------------
+
+static int write_all(int fd, const void* buf, size_t len) {
+    const char* p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Drains whatever is queued; returns records written
+static size_t drain_ring(Journal* j, JournalRecord* batch) {
+    size_t total = 0;
+    size_t backlog = spsc_ring_size(j->ring);
+    if ((long long)backlog > atomic_load(&j->peak_backlog)) atomic_store(&j->peak_backlog, (long long)backlog);
+    size_t n;
+    while ((n = spsc_ring_pop_batch(j->ring, batch, JOURNAL_WRITE_BATCH)) > 0) {
+        if (write_all(j->fd, batch, n * sizeof(JournalRecord)) != 0) atomic_store(&j->failed, 1);
+        else atomic_fetch_add(&j->written, (long long)n);
+        total += n;
+    }
+    return total;
+}
+
+static void sync_file(Journal* j) {
+    if (fdatasync(j->fd) != 0) atomic_store(&j->failed, 1);
+    atomic_fetch_add(&j->syncs, 1);
+}
+
+static void* journal_writer(void* arg) {
+    Journal* j = arg;
+    JournalRecord* batch = malloc(JOURNAL_WRITE_BATCH * sizeof(JournalRecord));
+    if (batch == NULL) {
+        atomic_store(&j->failed, 1);
+        return NULL;
+    }
+    int64_t next_sync = monotonic_ns() + JOURNAL_SYNC_MS * 1000000LL;
+    int dirty = 0;
+    while (atomic_load(&j->running)) {
+        if (drain_ring(j, batch) > 0) dirty = 1;
+        int64_t now = monotonic_ns();
+        if (dirty && now >= next_sync) {
+            sync_file(j);
+            dirty = 0;
+            next_sync = now + JOURNAL_SYNC_MS * 1000000LL;
+        }
+        if (spsc_ring_size(j->ring) == 0) sleep_until_ns(now + JOURNAL_IDLE_MS * 1000000LL);
+    }
+    drain_ring(j, batch); // The producer has stopped: this is everything
+    free(batch);
+    return NULL;
+}
+
+// ---------------- Journal ----------------
+
+int journal_open(Journal* j, const char* path, int64_t start_ns, time_t start_wall, int lossless) {
+    memset(j, 0, sizeof(*j));
+    j->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (j->fd < 0) return -1;
+    j->lossless = lossless;
+    j->header.magic = JOURNAL_MAGIC;
+    j->header.version = JOURNAL_VERSION;
+    j->header.record_size = sizeof(JournalRecord);
+    j->header.start_ns = start_ns;
+    j->header.start_wall = (int64_t)start_wall;
+    // Rewritten on close; until then readers size the journal from the file
+    if (write_all(j->fd, &j->header, sizeof(j->header)) != 0) {
+        close(j->fd);
+        return -1;
+    }
+
+    j->ring = spsc_ring_create(JOURNAL_RING_CAPACITY, sizeof(JournalRecord));
+    atomic_init(&j->dropped, 0);
+    atomic_init(&j->running, 1);
+    atomic_init(&j->written, 0);
+    atomic_init(&j->syncs, 0);
+    atomic_init(&j->peak_backlog, 0);
+    atomic_init(&j->failed, 0);
+    if (j->ring == NULL || pthread_create(&j->writer, NULL, journal_writer, j) != 0) {
+        if (j->ring) spsc_ring_destroy(j->ring);
+        close(j->fd);
+        return -1;
+    }
+    return 0;
+}
+
+int journal_append(Journal* j, const JournalRecord* rec) {
+    j->appended++;
+    while (spsc_ring_push(j->ring, rec) != 0) {
+        if (!j->lossless) {
+            atomic_fetch_add(&j->dropped, 1);
+            return 1;
+        }
+        sched_yield(); // Let the writer catch up
+    }
+    return 0;
+}
+
+int journal_close(Journal* j) {
+    atomic_store(&j->running, 0);
+    pthread_join(j->writer, NULL);
+    sync_file(j);
+
+    j->header.record_count = (uint64_t)atomic_load(&j->written);
+    j->header.dropped = (uint64_t)atomic_load(&j->dropped);
+    int rc = atomic_load(&j->failed) ? -1 : 0;
+    if (pwrite(j->fd, &j->header, sizeof(j->header), 0) != (ssize_t)sizeof(j->header) || fdatasync(j->fd) != 0) rc = -1;
+    if (close(j->fd) != 0) rc = -1;
+    spsc_ring_destroy(j->ring);
+    j->ring = NULL;
+    return rc;
+}
+
+// ---------------- Reader ----------------
+
+int journal_dump(const char* path, FILE* out) {
+    FILE* in = fopen(path, "rb");
+    if (in == NULL) return -1;
+    JournalHeader h;
+    if (fread(&h, sizeof(h), 1, in) != 1 || h.magic != JOURNAL_MAGIC || h.version != JOURNAL_VERSION ||
+        h.record_size != sizeof(JournalRecord)) {
+        fclose(in);
+        return -1;
+    }
+
+    // An unclosed journal (crash, kill -9) keeps every whole record
+    fprintf(out, "id,lane,type,arrival_s,green_s,crossed_s,delay_s,emergency_round,preempted\n");
+    JournalRecord batch[1024];
+    uint64_t count = 0;
+    size_t n;
+    while ((n = fread(batch, sizeof(JournalRecord), 1024, in)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            const JournalRecord* r = &batch[i];
+            fprintf(out, "%d,%s,%s,%.6f,%.6f,%.6f,%.6f,%d,%d\n", r->id,
+                    r->lane < NUM_LANES ? lane_names[r->lane] : "?",
+                    r->type < NUM_VEHICLE_TYPES ? type_names[r->type] : "?",
+                    (r->arrival_ns - h.start_ns) / 1e9, (r->green_ns - h.start_ns) / 1e9,
+                    (r->crossed_ns - h.start_ns) / 1e9, (r->crossed_ns - r->arrival_ns) / 1e9,
+                    (r->flags & JOURNAL_EMERGENCY_ROUND) != 0, (r->flags & JOURNAL_PREEMPTED) != 0);
+        }
+        count += n;
+    }
+    fclose(in);
+    fprintf(stderr, "%llu records%s, %llu dropped while recording\n", (unsigned long long)count,
+            h.record_count == 0 && count > 0 ? " (journal not closed)" : "", (unsigned long long)h.dropped);
+    return 0;
+}
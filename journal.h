@@ -0,0 +1,75 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include "spsc_ring.h"
+
+// Crossing journal
+// One fixed-width record per vehicle that crossed, for audits. The
+// controller thread only pushes the record into a lock-free SPSC ring; a
+// background writer drains the ring in batches to the file and fdatasyncs
+// it every JOURNAL_SYNC_MS. If the writer falls behind and the ring fills,
+// live runs drop the record and count it rather than stall the phase
+// machine; headless runs (lossless) wait for the writer instead.
+#define JOURNAL_MAGIC 0x314C4E524A525254ULL // "TRTRJNL1"
+#define JOURNAL_VERSION 1
+#define JOURNAL_RING_CAPACITY 65536 // Records (2 MB)
+#define JOURNAL_WRITE_BATCH 4096
+#define JOURNAL_IDLE_MS 10          // Writer poll interval when the ring is empty
+#define JOURNAL_SYNC_MS 1000
+
+// Record flags
+#define JOURNAL_EMERGENCY_ROUND 0x01 // Served by an emergency round
+#define JOURNAL_PREEMPTED 0x02       // Its green was cut short by an emergency while it crossed
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t record_count;  // Written on close (0 = not closed: size from the file)
+    uint64_t dropped;       // Records lost to a full ring
+    int64_t start_ns;       // Controller clock at start (monotonic live, virtual headless)
+    int64_t start_wall;     // time(NULL) at start_ns
+} JournalHeader;
+
+typedef struct {
+    int32_t id;
+    uint8_t type;
+    uint8_t lane;
+    uint8_t flags;
+    uint8_t reserved;
+    int64_t arrival_ns;     // Controller clock
+    int64_t green_ns;       // Start of the green it crossed on
+    int64_t crossed_ns;
+} JournalRecord;
+
+typedef struct {
+    SpscRing* ring;
+    int fd;
+    int lossless;
+    pthread_t writer;
+    JournalHeader header;
+
+    _Alignas(CACHE_LINE) long long appended; // Controller thread
+    atomic_llong dropped;
+
+    _Alignas(CACHE_LINE) atomic_int running; // Writer thread
+    atomic_llong written;
+    atomic_llong syncs;
+    atomic_llong peak_backlog;  // Most records found waiting in the ring
+    atomic_int failed;          // A write or sync failed
+} Journal;
+
+int journal_open(Journal* j, const char* path, int64_t start_ns, time_t start_wall, int lossless);
+// Controller thread only. 0 = queued, 1 = dropped (ring full)
+int journal_append(Journal* j, const JournalRecord* rec);
+int journal_close(Journal* j); // Drains the ring, syncs and writes the final header
+
+// Journal as CSV, times in seconds since start (0 = ok)
+int journal_dump(const char* path, FILE* out);
+
+#endif
@@ -0,0 +1,61 @@
+#include "lane_intake.h"
+
+int lane_intake_init(LaneIntake* in, size_t capacity) {
+    memset(in, 0, sizeof(*in));
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0) return -1;
+    in->slots = (LaneIntakeSlot*)malloc(capacity * sizeof(LaneIntakeSlot));
+    if (in->slots == NULL) return -1;
+    for (size_t i = 0; i < capacity; i++) atomic_init(&in->slots[i].seq, i);
+    atomic_init(&in->tail, 0);
+    in->head = 0;
+    in->mask = capacity - 1;
+    return 0;
+}
+
+void lane_intake_free(LaneIntake* in) {
+    free(in->slots);
+    memset(in, 0, sizeof(*in));
+}
+
+int lane_intake_push(LaneIntake* in, const Vehicle* v) {
+    uint64_t pos = atomic_load_explicit(&in->tail, memory_order_relaxed);
+    LaneIntakeSlot* slot;
+    for (;;) {
+        slot = &in->slots[pos & in->mask];
+        uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        int64_t diff = (int64_t)(seq - pos);
+        if (diff == 0) {
+            // Free slot at our position: claim it (a failed CAS reloads pos)
+            if (atomic_compare_exchange_weak_explicit(&in->tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            return 1; // Slot still holds the vehicle from one lap ago: full
+        } else {
+            pos = atomic_load_explicit(&in->tail, memory_order_relaxed); // Another producer got it
+        }
+    }
+    slot->v = *v;
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    return 0;
+}
+
+int lane_intake_pop(LaneIntake* in, Vehicle* out) {
+    LaneIntakeSlot* slot = &in->slots[in->head & in->mask];
+    uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if (seq != in->head + 1) return 1; // Empty, or the producer is still writing it
+    *out = slot->v;
+    // Hand the slot to the producer one lap ahead
+    atomic_store_explicit(&slot->seq, in->head + in->mask + 1, memory_order_release);
+    in->head++;
+    return 0;
+}
+
+int lane_intake_drain(LaneIntake* in, LaneQueue* q) {
+    int moved = 0;
+    Vehicle v;
+    while (lane_intake_pop(in, &v) == 0) {
+        add_vehicle(q, v);
+        moved++;
+    }
+    return moved;
+}
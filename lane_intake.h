@@ -0,0 +1,40 @@
+#ifndef LANE_INTAKE_H
+#define LANE_INTAKE_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include "utils.h"
+#include "spsc_ring.h"
+
+// Per-lane arrival intake: multi-producer/single-consumer, lock-free.
+// Any thread may submit vehicles; only the lane's owner (the controller
+// thread) pops them and moves them into its LaneQueue, so the LaneQueue
+// itself needs no lock. Bounded ring with a sequence number per slot:
+// producers claim a slot with one CAS on `tail` and publish it by bumping
+// the slot's sequence, so a slow producer never blocks the consumer
+// from seeing slots claimed before it.
+#define LANE_INTAKE_CAPACITY 4096 // Per lane, power of two
+
+typedef struct {
+    _Atomic uint64_t seq; // == position: free; == position + 1: holds a vehicle
+    Vehicle v;
+} LaneIntakeSlot;
+
+typedef struct {
+    _Alignas(CACHE_LINE) _Atomic uint64_t tail; // Next position to claim (producers)
+    _Alignas(CACHE_LINE) uint64_t head;         // Next position to pop (consumer)
+    _Alignas(CACHE_LINE) uint64_t mask;
+    LaneIntakeSlot* slots;
+} LaneIntake;
+
+int lane_intake_init(LaneIntake* in, size_t capacity); // 0 = ok
+void lane_intake_free(LaneIntake* in);
+
+// Producer side, any thread: 0 = ok, 1 = full (the owner is behind)
+int lane_intake_push(LaneIntake* in, const Vehicle* v);
+
+// Consumer side, owner thread only: 0 = ok, 1 = empty
+int lane_intake_pop(LaneIntake* in, Vehicle* out);
+int lane_intake_drain(LaneIntake* in, LaneQueue* q); // Moves everything ready; returns count
+
+#endif
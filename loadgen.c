@@ -0,0 +1,241 @@
+#include "loadgen.h"
+#include <math.h>
+#include <sched.h>
+#include <unistd.h>
+
+#define SEC_PER_DAY 86400.0
+
+static const char* model_names[] = { "poisson", "platoon", "rush-hour" };
+
+void load_default_config(LoadConfig* cfg) {
+    cfg->model = LOAD_POISSON;
+    cfg->rate = 1.0 / 4.5; // The old generator's mean: one vehicle every 3-6 s
+    cfg->producers = 1;
+    for (int i = 0; i < NUM_LANES; i++) cfg->lane_weight[i] = 1.0;
+    cfg->type_mix[REGULAR_CAR] = 90;
+    cfg->type_mix[AMBULANCE] = 5;
+    cfg->type_mix[POLICE] = 3;
+    cfg->type_mix[FIRE_TRUCK] = 2;
+    cfg->platoon_size = 6;
+    cfg->platoon_headway_sec = 2.0;
+    cfg->rush_peak = 3.0;
+    cfg->day_sec = SEC_PER_DAY;
+    cfg->start_hour = -1;
+    cfg->seed = 0;
+}
+
+int load_parse_model(const char* name, LoadModel* out) {
+    for (int i = 0; i < (int)(sizeof(model_names) / sizeof(model_names[0])); i++) {
+        if (strcmp(name, model_names[i]) == 0) {
+            *out = (LoadModel)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char* load_model_name(LoadModel model) {
+    return model_names[model];
+}
+
+// xorshift64*, as sim_rand; kept local so producers link without the simulator
+static uint64_t next_rand(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static double uniform(uint64_t* state) {
+    return (next_rand(state) >> 11) * (1.0 / 9007199254740992.0); // [0, 1)
+}
+
+static double exponential(uint64_t* state, double mean) {
+    return -log1p(-uniform(state)) * mean;
+}
+
+// Base curve: 0.2 at 03:00 rising to 1.0 at 15:00, plus a one-hour-wide
+// bump at each peak that lifts it to exactly rush_peak there
+static double base_curve(double hour) {
+    return 0.6 - 0.4 * cos(2 * M_PI * (hour - 3) / 24);
+}
+
+static double bump(double hour, double peak_hour) {
+    double x = hour - peak_hour;
+    return exp(-0.5 * x * x);
+}
+
+double load_rate_at(const LoadConfig* cfg, double tod_sec) {
+    double hour = fmod(tod_sec, SEC_PER_DAY) / 3600;
+    double shape = base_curve(hour) +
+                   (cfg->rush_peak - base_curve(8.0)) * bump(hour, 8.0) +
+                   (cfg->rush_peak - base_curve(17.5)) * bump(hour, 17.5);
+    return cfg->rate * (shape > 0 ? shape : 0);
+}
+
+// Cumulative shares as thresholds on a 64-bit draw: picking is one
+// comparison per entry, no floating point
+static void build_cuts(const double weight[], int n, uint64_t cut[]) {
+    double total = 0, sum = 0;
+    for (int i = 0; i < n; i++) total += weight[i];
+    for (int i = 0; i < n; i++) {
+        sum += weight[i];
+        cut[i] = sum >= total ? UINT64_MAX : (uint64_t)(sum / total * 18446744073709549568.0);
+    }
+}
+
+static int pick(uint64_t* state, const uint64_t cut[], int n) {
+    uint64_t r = next_rand(state);
+    for (int i = 0; i < n - 1; i++) {
+        if (r < cut[i]) return i;
+    }
+    return n - 1;
+}
+
+static double time_of_day(const LoadGen* g, int64_t offset_ns) {
+    return g->tod_start_sec + offset_ns / 1e9 * (SEC_PER_DAY / g->cfg.day_sec);
+}
+
+// Gap to the next arrival, and its lane
+static int64_t next_gap(LoadGen* g, int* lane) {
+    const LoadConfig* cfg = &g->cfg;
+    if (g->rate <= 0) {
+        *lane = pick(&g->rng, g->lane_cut, NUM_LANES);
+        return 0; // Unpaced: everything is due now
+    }
+
+    switch (cfg->model) {
+    case LOAD_PLATOON: {
+        // Gaps between platoons are sized so the long-run rate is still
+        // `rate`; platoons run back to back when the headway cannot allow it
+        double size = cfg->platoon_size > 1 ? cfg->platoon_size : 1;
+        double headway = cfg->platoon_headway_sec;
+        if (g->platoon_left > 0) {
+            g->platoon_left--;
+            *lane = g->platoon_lane;
+            return (int64_t)(headway * 1e9);
+        }
+        double between = size / g->rate - (size - 1) * headway;
+        if (between < headway) between = headway;
+        // Geometric length with mean `size`
+        double stop = 1.0 / size;
+        int length = 1;
+        if (stop < 1) length += (int)floor(log1p(-uniform(&g->rng)) / log1p(-stop));
+        g->platoon_left = length - 1;
+        *lane = g->platoon_lane = pick(&g->rng, g->lane_cut, NUM_LANES);
+        return (int64_t)(exponential(&g->rng, between) * 1e9);
+    }
+    case LOAD_RUSH_HOUR: {
+        // Thinning: candidates at the peak rate, kept in proportion to the
+        // curve at their time of day
+        double peak = g->peak_rate;
+        int64_t gap = 0;
+        for (;;) {
+            gap += (int64_t)(exponential(&g->rng, 1.0 / peak) * 1e9);
+            double rate = load_rate_at(cfg, time_of_day(g, g->next_ns + gap)) / cfg->producers;
+            if (uniform(&g->rng) * peak < rate) break;
+        }
+        *lane = pick(&g->rng, g->lane_cut, NUM_LANES);
+        return gap;
+    }
+    default:
+        *lane = pick(&g->rng, g->lane_cut, NUM_LANES);
+        return (int64_t)(exponential(&g->rng, 1.0 / g->rate) * 1e9);
+    }
+}
+
+static void generate(LoadGen* g) {
+    int lane;
+    g->next_ns += next_gap(g, &lane);
+    g->pending.id = g->next_id;
+    g->pending.lane = lane;
+    g->pending.type = pick(&g->rng, g->type_cut, NUM_VEHICLE_TYPES);
+    g->next_id = (int)(((unsigned)g->next_id + (unsigned)g->id_stride) & 0x7FFFFFFF);
+}
+
+void loadgen_init(LoadGen* g, const LoadConfig* cfg, int producer) {
+    memset(g, 0, sizeof(*g));
+    g->cfg = *cfg;
+    if (g->cfg.producers < 1) g->cfg.producers = 1;
+    if (g->cfg.day_sec <= 0) g->cfg.day_sec = SEC_PER_DAY;
+    g->rate = cfg->rate / g->cfg.producers;
+
+    // splitmix64 finaliser: independent, non-zero streams per producer
+    uint64_t seed = cfg->seed ? cfg->seed : (uint64_t)monotonic_ns() ^ ((uint64_t)getpid() << 32);
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL * (producer + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    g->rng = z ? z : 1;
+
+    build_cuts(cfg->lane_weight, NUM_LANES, g->lane_cut);
+    build_cuts(cfg->type_mix, NUM_VEHICLE_TYPES, g->type_cut);
+    g->next_id = 1000 + producer;
+    g->id_stride = g->cfg.producers;
+
+    if (cfg->start_hour >= 0) {
+        g->tod_start_sec = cfg->start_hour * 3600;
+    } else {
+        time_t now = time(NULL);
+        struct tm local;
+        localtime_r(&now, &local);
+        g->tod_start_sec = local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec;
+    }
+    for (int m = 0; m < 24 * 60; m++) {
+        double r = load_rate_at(&g->cfg, m * 60.0) / g->cfg.producers;
+        if (r > g->peak_rate) g->peak_rate = r;
+    }
+    g->peak_rate *= 1.02; // The curve is sampled per minute
+    generate(g);
+}
+
+void loadgen_take(LoadGen* g, VehicleMessage* out) {
+    *out = g->pending;
+    generate(g);
+}
+
+void loadgen_run(const LoadConfig* cfg, int transport, int producer, volatile int* running, LoadStats* stats) {
+    TrafficChannel* ch = join_queue(transport);
+    if (ch == NULL) exit(1);
+    LoadGen g;
+    loadgen_init(&g, cfg, producer);
+    int paced = g.rate > 0;
+
+    VehicleMessage batch[LOAD_BATCH];
+    int64_t origin = monotonic_ns();
+    while (*running) {
+        int64_t now = monotonic_ns() - origin;
+        int64_t late = now - loadgen_peek(&g);
+        int n = 0;
+        while (n < LOAD_BATCH && (!paced || loadgen_peek(&g) <= now)) loadgen_take(&g, &batch[n++]);
+        if (n == 0) {
+            // Nothing due: sleep to the next arrival on an absolute deadline
+            sleep_until_ns(origin + loadgen_peek(&g)); // EINTR: the loop re-checks
+            continue;
+        }
+
+        time_t stamp = time(NULL);
+        for (int i = 0; i < n; i++) batch[i].timestamp = stamp;
+        int done = 0;
+        long long stalls = 0;
+        while (done < n && *running) {
+            int k = send_vehicle_batch(ch, batch + done, n - done);
+            if (k <= 0) {
+                stalls++;
+                sched_yield(); // Ring full: the controller is behind
+                continue;
+            }
+            done += k;
+        }
+        if (stats) {
+            atomic_fetch_add_explicit(&stats->sent, done, memory_order_relaxed);
+            if (stalls) atomic_fetch_add_explicit(&stats->stalls, stalls, memory_order_relaxed);
+            if (paced && late > atomic_load_explicit(&stats->late_ns, memory_order_relaxed)) {
+                atomic_store_explicit(&stats->late_ns, late, memory_order_relaxed);
+            }
+        }
+    }
+    cleanup_queue(ch);
+}
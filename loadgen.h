@@ -0,0 +1,74 @@
+#ifndef LOADGEN_H
+#define LOADGEN_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "ipc_manager.h"
+
+// Parametric arrival generator for the live controller
+// Each producer process runs its own generator with an independent random
+// stream and an equal share of the rate, and feeds its own shm ring, so K
+// producers fan in without sharing anything. Arrivals are generated ahead
+// on the producer's clock and sent in batches of everything already due,
+// so the per-vehicle cost is a few random numbers whatever the rate.
+#define LOAD_BATCH 256
+#define LOAD_MAX_PRODUCERS (SHM_MAX_PRODUCERS - 1) // One ring stays with the keyboard
+
+typedef enum {
+    LOAD_POISSON,   // Exponential gaps at a constant rate
+    LOAD_PLATOON,   // Platoons of cars released together at a short headway
+    LOAD_RUSH_HOUR  // Poisson with a time-of-day rate curve
+} LoadModel;
+
+typedef struct {
+    LoadModel model;
+    double rate;                        // Vehicles/s over all producers (0 = as fast as the transport takes them)
+    int producers;                      // Generator processes
+    double lane_weight[NUM_LANES];      // Relative arrival share per lane
+    double type_mix[NUM_VEHICLE_TYPES]; // Relative share per vehicle type
+    double platoon_size;                // Mean platoon length (platoon model)
+    double platoon_headway_sec;         // Gap between cars of one platoon
+    double rush_peak;                   // Rate at the 08:00 and 17:30 peaks, relative to midday
+    double day_sec;                     // Real seconds per simulated day (rush-hour model)
+    double start_hour;                  // Time of day at start (rush-hour model; < 0 = local time)
+    uint64_t seed;                      // 0 = seeded from the clock
+} LoadConfig;
+
+// One producer's generator state
+typedef struct {
+    LoadConfig cfg;
+    double rate;                          // This producer's share
+    uint64_t rng;
+    uint64_t lane_cut[NUM_LANES];         // Cumulative thresholds on a raw random draw
+    uint64_t type_cut[NUM_VEHICLE_TYPES];
+    int64_t next_ns;                      // Offset of the pending arrival
+    VehicleMessage pending;
+    int next_id;
+    int id_stride;                        // Producers interleave ids
+    int platoon_left;                     // Cars still to come in the current platoon
+    int platoon_lane;
+    double peak_rate;                     // Thinning bound (rush-hour)
+    double tod_start_sec;
+} LoadGen;
+
+// Producer counters, in memory the parent can read (MAP_SHARED)
+typedef struct {
+    atomic_llong sent;
+    atomic_llong stalls;  // Sends that found the ring full
+    atomic_llong late_ns; // Worst lag behind schedule
+} LoadStats;
+
+void load_default_config(LoadConfig* cfg);
+int load_parse_model(const char* name, LoadModel* out); // 0 = ok
+const char* load_model_name(LoadModel model);
+double load_rate_at(const LoadConfig* cfg, double tod_sec); // Rush-hour rate at a time of day
+
+void loadgen_init(LoadGen* g, const LoadConfig* cfg, int producer);
+void loadgen_take(LoadGen* g, VehicleMessage* out); // Pending arrival; generates the next
+static inline int64_t loadgen_peek(const LoadGen* g) { return g->next_ns; }
+
+// Producer loop: joins the transport and sends until *running drops.
+// stats may be NULL.
+void loadgen_run(const LoadConfig* cfg, int transport, int producer, volatile int* running, LoadStats* stats);
+
+#endif
@@ -6,18 +6,61 @@
 #include <termios.h>
 #include <pthread.h>
 #include <time.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 #include "utils.h"
 #include "ipc_manager.h"
 #include "traffic_logic.h"
+#include "controller.h"
+#include "sim.h"
+#include "network.h"
+#include "metrics.h"
+#include "renderer.h"
+#include "trace.h"
+#include "loadgen.h"
+#include "timer_wheel.h"
+#include "checkpoint.h"
+#include "state_page.h"
+#include "sweep.h"
+#include "tracepoint.h"
 
 // Globals
-pid_t generator_pid;
+pid_t generator_pids[LOAD_MAX_PRODUCERS];
+int generator_count = 0;
 volatile int keep_running = 1;
 struct termios orig_termios;
-mqd_t global_mq;
+TrafficChannel* global_mq;
+int ipc_transport = TRANSPORT_SHM;
 
-#define GREEN_DURATION_SEC 8
-#define CROSSING_TIME_USEC 1500000 // 1.5s per car
+// Emergency detection latency: producer hand-off -> queued for scheduling
+long long emergency_arrivals = 0;
+int64_t emergency_latency_sum_ns = 0;
+int64_t emergency_latency_max_ns = 0;
+
+long long invalid_messages = 0; // Dropped by check_mq_updates: lane or type out of range
+
+// Latency histograms and throughput counters (see metrics.h)
+Metrics* live_metrics;
+const char* stats_path = "traffic_stats.csv";
+double stats_interval_sec = 10.0; // Periodic stats file; 0 = only on SIGUSR1 and exit
+volatile sig_atomic_t stats_dump_requested = 0;
+
+// Arrival traces (see trace.h)
+TraceWriter live_record;
+int recording = 0;
+
+// Crossing journal (see journal.h)
+Journal live_journal;
+int journaling = 0;
+
+// Controller checkpoint for restarts (see checkpoint.h)
+Checkpoint live_checkpoint;
+int checkpointing = 0;
+
+// Read-only state for external monitors (see state_page.h)
+StatePage* state_page;
+
+#define INGEST_PASS_MAX 8192 // Vehicles taken from the transport per loop pass
 
 void disable_raw_mode() {
     tcsetattr(STDIN_FILENO, TCSAFLUSH, &orig_termios);
@@ -35,40 +78,48 @@ void handle_sigint(int sig) {
     keep_running = 0;
 }
 
-void vehicle_generator_process() {
-    mqd_t mq = join_queue();
-    if (mq == (mqd_t)-1) exit(1);
-    
-    srand(time(NULL));
-    int v_id = 1000; 
-    
-    while (keep_running) {
+void handle_sigusr1(int sig) {
+    stats_dump_requested = 1; // Written from the main loop, not the handler
+}
+
+// Stands in for the generator: sends the trace's arrivals at their
+// recorded spacing, starting now
+void trace_replay_process(const char* path, double from_sec) {
+    TrafficChannel* mq = join_queue(ipc_transport);
+    if (mq == NULL) exit(1);
+    TraceReader trace;
+    if (trace_reader_open(&trace, path) != 0) exit(1);
+    int64_t from = (int64_t)(from_sec * 1e9);
+    trace_seek(&trace, from);
+
+    int64_t origin = monotonic_ns();
+    TraceArrival a;
+    while (keep_running && trace_next(&trace, &a) == 0) {
+        int64_t due = origin + a.offset_ns - from;
+        while (sleep_until_ns(due) != 0 && keep_running) { /* EINTR */ }
+
         VehicleMessage msg;
-        msg.id = v_id++;
-        msg.lane = rand() % 4; 
-        
-        int r = rand() % 100;
-        if (r < 5) msg.type = AMBULANCE;
-        else if (r < 8) msg.type = POLICE;
-        else if (r < 10) msg.type = FIRE_TRUCK;
-        else msg.type = REGULAR_CAR;
-        
+        msg.id = a.id;
+        msg.lane = a.lane;
+        msg.type = a.type;
         msg.timestamp = time(NULL);
-        
         send_vehicle_msg(mq, &msg);
-        
-        // Random arrival: 3s to 6s
-        usleep((rand() % 3000000) + 3000000);
     }
-    mq_close(mq);
+    trace_reader_close(&trace);
+    cleanup_queue(mq);
     exit(0);
 }
 
 void* user_input_thread(void* arg) {
     int v_id_user = 1; 
     char c;
+    // Own producer endpoint: the shm rings are single-producer
+    TrafficChannel* input_mq = join_queue(ipc_transport);
+    if (input_mq == NULL) return NULL;
     while (keep_running) {
-        if (read(STDIN_FILENO, &c, 1) == 1) {
+        ssize_t got = read(STDIN_FILENO, &c, 1);
+        if (got == 0) break; // EOF: no keyboard attached
+        if (got == 1) {
             VehicleMessage msg;
             msg.id = v_id_user++;
             msg.timestamp = time(NULL);
@@ -85,41 +136,338 @@ void* user_input_thread(void* arg) {
                 valid = 1;
             }
             if (valid) {
-                send_vehicle_msg(global_mq, &msg);
+                send_vehicle_msg(input_mq, &msg);
             }
         }
     }
+    cleanup_queue(input_mq);
     return NULL;
 }
 
-void check_mq_updates() {
-    VehicleMessage msg;
-    while (receive_vehicle_msg(global_mq, &msg) == 0) {
-        Vehicle v;
-        v.id = msg.id;
-        v.type = msg.type;
-        v.lane = msg.lane;
-        v.arrival_time = msg.timestamp;
-        v.priority_score = 0;
-        
-        pthread_mutex_lock(&queue_mutex);
-        add_vehicle(&lane_queues[v.lane], v);
-        pthread_mutex_unlock(&queue_mutex);
+// Drains the transport into the lane intakes; returns the number of vehicles
+// received. Runs on the controller thread, so a full intake is emptied into
+// the lanes on the spot instead of waiting.
+// Bounded per call, so a flood of arrivals cannot hold off the phase timer.
+int check_mq_updates(Controller* ctl) {
+    VehicleMessage batch[64];
+    int n;
+    int total = 0;
+    while (total < INGEST_PASS_MAX && (n = receive_vehicle_batch(global_mq, batch, 64)) > 0) {
+        int64_t now = monotonic_ns();
+        total += n;
+        for (int i = 0; i < n; i++) {
+            Vehicle v = { 0 };
+            v.id = batch[i].id;
+            v.type = batch[i].type;
+            v.lane = batch[i].lane;
+            v.arrival_time = batch[i].timestamp;
+            v.arrival_ns = batch[i].sent_ns; // Same clock as the controller
+            v.priority_score = 0;
+            int rc;
+            while ((rc = submit_vehicle(&v)) == SUBMIT_FULL) controller_collect_arrivals(ctl);
+            if (rc == SUBMIT_INVALID) {
+                invalid_messages++; // Never queued, logged or recorded
+                continue;
+            }
+            if (checkpointing) checkpoint_log(&live_checkpoint, CHECKPOINT_ARRIVAL, &v);
+            if (recording) trace_write(&live_record, batch[i].sent_ns, v.id, v.lane, v.type);
+
+            if (v.type != REGULAR_CAR) {
+                int64_t latency = now - batch[i].sent_ns;
+                emergency_arrivals++;
+                emergency_latency_sum_ns += latency;
+                if (latency > emergency_latency_max_ns) emergency_latency_max_ns = latency;
+            }
+        }
+    }
+    return total;
+}
+
+void on_live_crossing(void* ctx, const Vehicle* v, sim_time_t now) {
+    log_vehicle(*v); // Add to history
+    sensor_count_departure(&lane_sensors[v->lane]);
+    if (checkpointing) checkpoint_log(&live_checkpoint, CHECKPOINT_DEPARTURE, v);
+    if (journaling) {
+        JournalRecord rec;
+        controller_journal_entry(ctx, v, now, &rec);
+        journal_append(&live_journal, &rec); // Never blocks: a full ring drops and counts
+    }
+}
+
+// One-shot timerfd at the earliest live timer (absolute, monotonic)
+void arm_timer_fd(int timer_fd, int64_t when) {
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its)); // All zero disarms
+    if (when != SIM_TIME_NEVER) {
+        its.it_value.tv_sec = when / SIM_SEC(1);
+        its.it_value.tv_nsec = when % SIM_SEC(1);
+    }
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+// Live timers: the controller's next deadline plus the periodic stats file
+// and redraw, all on one wheel behind a single timerfd. Periodic timers
+// keep their period in data.
+enum { LIVE_PHASE, LIVE_STATS, LIVE_REFRESH, LIVE_TIMERS };
+
+void write_stats() {
+    if (metrics_write_file(live_metrics, stats_path, monotonic_ns()) != 0) {
+        // Raw mode terminal: keep it to one line
+        fprintf(stderr, "stats: cannot write %s\r\n", stats_path);
     }
 }
 
-void render(int green_lane, Vehicle* crossing) {
-    clear_screen();
-    print_header();
-    pthread_mutex_lock(&queue_mutex);
-    draw_traffic_scene(lane_queues, green_lane, crossing);
-    pthread_mutex_unlock(&queue_mutex);
+// Hands the render thread a snapshot; the terminal is never touched here.
+// Controller thread only: it owns the lanes, so no lock is needed.
+void render(Renderer* r, unsigned green_mask, const Vehicle crossing[]) {
+    SceneSnapshot snap;
+    capture_scene(&snap, lane_queues, green_mask, crossing);
+    snap.has_sensors = 1;
+    for (int i = 0; i < NUM_LANES; i++) sensor_read(&lane_sensors[i], &snap.sensors[i]);
+    renderer_publish(r, &snap);
+}
+
+// Finishes the trace point JSON, if one is being recorded
+void close_tracepoints(const char* path) {
+    if (path == NULL) return;
+    if (tp_close() != 0) perror("tracepoints: writing the trace failed");
+    else printf("Trace points: %lld events written to %s, %lld dropped (writer behind)\n", tp_written(), path, tp_dropped());
 }
 
-int main() {
+void print_usage(const char* prog) {
+    printf("Usage: %s [--transport shm|mq] [--headless] [--network RxC [--threads N] [--sweep] [--link-sec S] [--turn-ratio R]]\n"
+           "          [--hours H | --seconds S] [--seed N] [--arrival-scale X] [--lane-weights N,S,E,W]\n"
+           "          [--scheduler fixed|max-pressure] [--single-lane] [--headway S] [--compare-schedulers]\n"
+           "          [--stats-file PATH] [--stats-interval S]   (live: kill -USR1 dumps stats now)\n"
+           "          [--record TRACE] [--replay TRACE [--replay-from S]]   (headless replay runs flat out)\n"
+           "          [--journal FILE] [--journal-dump FILE]   (crossing journal; dump prints it as CSV)\n"
+           "          [--checkpoint FILE]   (live: resume the queues and phase a previous run left in FILE)\n"
+           "          [--tracepoints FILE]   (Chrome trace JSON; needs a make TRACEPOINTS=1 build)\n"
+           "          [--load poisson|platoon|rush-hour] [--rate VPS] [--producers K] [--type-mix C,A,P,F]\n"
+           "          [--platoon N[,HEADWAY]] [--rush-peak X] [--day-sec S] [--start-hour H] [--load-seed N]\n"
+           "          [--param-sweep [--sweep-green S,..] [--sweep-aging N,..] [--sweep-all-red S,..] [--sweep-scale X,..]\n"
+           "           [--sweep-emergency PCT,..] [--sweep-seeds A-B] [--sweep-out CSV] [--threads N]]\n", prog);
+}
+
+// --sweep-<name> VALUE; -1 if the name is unknown or the value malformed
+static int parse_sweep_option(SweepConfig* cfg, const char* name, const char* value) {
+    if (strcmp(name, "green") == 0) return sweep_parse_axis(&cfg->green_sec, value);
+    if (strcmp(name, "aging") == 0) return sweep_parse_axis(&cfg->aging_threshold, value);
+    if (strcmp(name, "all-red") == 0) return sweep_parse_axis(&cfg->all_red_sec, value);
+    if (strcmp(name, "scale") == 0) return sweep_parse_axis(&cfg->arrival_scale, value);
+    if (strcmp(name, "emergency") == 0) return sweep_parse_axis(&cfg->emergency_percent, value);
+    if (strcmp(name, "seeds") == 0) return sweep_parse_seeds(cfg, value);
+    if (strcmp(name, "out") == 0) {
+        cfg->out_path = value;
+        return 0;
+    }
+    return -1;
+}
+
+int main(int argc, char* argv[]) {
+    int headless = 0;
+    int network = 0;
+    int param_sweep = 0;
+    const char* checkpoint_path = NULL;
+    const char* tracepoints_path = NULL;
+    SimConfig sim_cfg;
+    NetConfig net_cfg;
+    LoadConfig load_cfg;
+    SweepConfig sweep_cfg;
+    sim_default_config(&sim_cfg);
+    sweep_default_config(&sweep_cfg);
+    network_default_config(&net_cfg);
+    load_default_config(&load_cfg);
+
+    for (int i = 1; i < argc; i++) {
+        int has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--headless") == 0) headless = 1;
+        else if (strcmp(argv[i], "--hours") == 0 && has_value) sim_cfg.duration_sec = net_cfg.duration_sec = atof(argv[++i]) * 3600.0;
+        else if (strcmp(argv[i], "--seconds") == 0 && has_value) sim_cfg.duration_sec = net_cfg.duration_sec = atof(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && has_value) sim_cfg.seed = net_cfg.seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--arrival-scale") == 0 && has_value) sim_cfg.arrival_scale = net_cfg.arrival_scale = atof(argv[++i]);
+        else if (strcmp(argv[i], "--network") == 0 && has_value) {
+            network = 1;
+            if (sscanf(argv[++i], "%dx%d", &net_cfg.rows, &net_cfg.cols) != 2) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--transport") == 0 && has_value) {
+            const char* t = argv[++i];
+            if (strcmp(t, "shm") == 0) ipc_transport = TRANSPORT_SHM;
+            else if (strcmp(t, "mq") == 0) ipc_transport = TRANSPORT_MQ;
+            else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && has_value) net_cfg.threads = sweep_cfg.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--sweep") == 0) net_cfg.sweep = 1;
+        else if (strcmp(argv[i], "--param-sweep") == 0) param_sweep = 1;
+        else if (strncmp(argv[i], "--sweep-", 8) == 0 && has_value) {
+            if (parse_sweep_option(&sweep_cfg, argv[i] + 8, argv[i + 1]) != 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--link-sec") == 0 && has_value) net_cfg.link_sec = atof(argv[++i]);
+        else if (strcmp(argv[i], "--turn-ratio") == 0 && has_value) net_cfg.turn_ratio = atof(argv[++i]);
+        else if (strcmp(argv[i], "--scheduler") == 0 && has_value) {
+            sim_cfg.scheduler = scheduler_find(argv[++i]);
+            if (sim_cfg.scheduler == NULL) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--headway") == 0 && has_value) {
+            sim_cfg.headway_sec = atof(argv[++i]);
+            if (sim_cfg.headway_sec < 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--single-lane") == 0) sim_cfg.conflicts = net_cfg.conflicts = conflicts_exclusive;
+        else if (strcmp(argv[i], "--compare-schedulers") == 0) headless = sim_cfg.compare_schedulers = 1;
+        else if (strcmp(argv[i], "--lane-weights") == 0 && has_value) {
+            double* w = sim_cfg.lane_weight;
+            if (sscanf(argv[++i], "%lf,%lf,%lf,%lf", &w[0], &w[1], &w[2], &w[3]) != NUM_LANES ||
+                w[0] < 0 || w[1] < 0 || w[2] < 0 || w[3] < 0 || w[0] + w[1] + w[2] + w[3] <= 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            memcpy(load_cfg.lane_weight, w, sizeof(load_cfg.lane_weight));
+        }
+        else if (strcmp(argv[i], "--load") == 0 && has_value) {
+            if (load_parse_model(argv[++i], &load_cfg.model) != 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--rate") == 0 && has_value) load_cfg.rate = atof(argv[++i]);
+        else if (strcmp(argv[i], "--producers") == 0 && has_value) {
+            load_cfg.producers = atoi(argv[++i]);
+            if (load_cfg.producers < 1 || load_cfg.producers > LOAD_MAX_PRODUCERS) {
+                fprintf(stderr, "--producers: 1 to %d\n", LOAD_MAX_PRODUCERS);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--type-mix") == 0 && has_value) {
+            double* m = load_cfg.type_mix;
+            if (sscanf(argv[++i], "%lf,%lf,%lf,%lf", &m[0], &m[1], &m[2], &m[3]) != NUM_VEHICLE_TYPES ||
+                m[0] < 0 || m[1] < 0 || m[2] < 0 || m[3] < 0 || m[0] + m[1] + m[2] + m[3] <= 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--platoon") == 0 && has_value) {
+            if (sscanf(argv[++i], "%lf,%lf", &load_cfg.platoon_size, &load_cfg.platoon_headway_sec) < 1) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            load_cfg.model = LOAD_PLATOON;
+        }
+        else if (strcmp(argv[i], "--rush-peak") == 0 && has_value) load_cfg.rush_peak = atof(argv[++i]);
+        else if (strcmp(argv[i], "--day-sec") == 0 && has_value) load_cfg.day_sec = atof(argv[++i]);
+        else if (strcmp(argv[i], "--start-hour") == 0 && has_value) load_cfg.start_hour = atof(argv[++i]);
+        else if (strcmp(argv[i], "--load-seed") == 0 && has_value) load_cfg.seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--record") == 0 && has_value) sim_cfg.record_path = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && has_value) sim_cfg.replay_path = argv[++i];
+        else if (strcmp(argv[i], "--replay-from") == 0 && has_value) sim_cfg.replay_from_sec = atof(argv[++i]);
+        else if (strcmp(argv[i], "--stats-file") == 0 && has_value) stats_path = sim_cfg.stats_path = argv[++i];
+        else if (strcmp(argv[i], "--stats-interval") == 0 && has_value) stats_interval_sec = atof(argv[++i]);
+        else if (strcmp(argv[i], "--journal") == 0 && has_value) sim_cfg.journal_path = argv[++i];
+        else if (strcmp(argv[i], "--checkpoint") == 0 && has_value) checkpoint_path = argv[++i];
+        else if (strcmp(argv[i], "--tracepoints") == 0 && has_value) tracepoints_path = argv[++i];
+        else if (strcmp(argv[i], "--journal-dump") == 0 && has_value) {
+            const char* path = argv[++i];
+            if (journal_dump(path, stdout) != 0) {
+                fprintf(stderr, "cannot read journal %s (missing or not a journal)\n", path);
+                return 1;
+            }
+            return 0;
+        }
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (tracepoints_path && tp_open(tracepoints_path) != 0) {
+#ifdef TRACEPOINTS
+        perror("tracepoints: cannot create the trace");
+#else
+        fprintf(stderr, "tracepoints: not in this build (make clean && make TRACEPOINTS=1)\n");
+#endif
+        return 1;
+    }
+    TP_THREAD("controller");
+
+    if (param_sweep) {
+        // Every run is headless, on lanes of its own
+        sweep_cfg.base = sim_cfg;
+        int rc = run_parameter_sweep(&sweep_cfg);
+        close_tracepoints(tracepoints_path);
+        return rc == 0 ? 0 : 1;
+    }
+
+    if (network) {
+        // Headless by nature: every intersection runs on virtual time
+        int rc = run_network_simulation(&net_cfg);
+        close_tracepoints(tracepoints_path);
+        return rc == 0 ? 0 : 1;
+    }
+
+    if (headless) {
+        // No terminal, no IPC, no threads: virtual time only
+        init_traffic_system();
+        int rc = run_headless_simulation(&sim_cfg);
+        cleanup_traffic_system();
+        close_tracepoints(tracepoints_path);
+        return rc == 0 ? 0 : 1;
+    }
+
     signal(SIGINT, handle_sigint);
+    signal(SIGUSR1, handle_sigusr1);
     
-    global_mq = create_queue();
+    if (sim_cfg.replay_path) {
+        // Fail before the terminal goes raw
+        TraceReader check;
+        if (trace_reader_open(&check, sim_cfg.replay_path) != 0) {
+            fprintf(stderr, "cannot replay %s (missing or not a trace)\n", sim_cfg.replay_path);
+            return 1;
+        }
+        trace_reader_close(&check);
+    }
+    if (sim_cfg.record_path) {
+        if (trace_writer_open(&live_record, sim_cfg.record_path, monotonic_ns(), time(NULL)) != 0) {
+            perror("cannot create trace");
+            return 1;
+        }
+        recording = 1;
+    }
+    if (sim_cfg.journal_path) {
+        if (journal_open(&live_journal, sim_cfg.journal_path, monotonic_ns(), time(NULL), 0) != 0) {
+            perror("cannot create journal");
+            return 1;
+        }
+        journaling = 1;
+    }
+    if (checkpoint_path) {
+        if (checkpoint_open(&live_checkpoint, checkpoint_path) != 0) {
+            fprintf(stderr, "cannot open checkpoint %s (not a checkpoint of this build?)\n", checkpoint_path);
+            return 1;
+        }
+        checkpointing = 1;
+    }
+
+    global_mq = create_queue(ipc_transport);
+    if (global_mq == NULL) return 1;
+    if (queue_salvaged(global_mq) > 0) {
+        printf("Recovered %d vehicles still in transit\n", queue_salvaged(global_mq));
+        fflush(stdout); // Before the generators fork
+    }
     init_traffic_system();
     enable_raw_mode(); 
 
@@ -137,92 +485,211 @@ int main() {
     pthread_t input_th;
     pthread_create(&input_th, NULL, user_input_thread, NULL);
 
-    // Generator
-    generator_pid = fork();
-    if (generator_pid == 0) vehicle_generator_process(); 
+    // Generators, one process per producer ring (or the trace being replayed)
+    generator_count = sim_cfg.replay_path ? 1 : load_cfg.producers;
+    for (int k = 0; k < generator_count; k++) {
+        generator_pids[k] = fork();
+        if (generator_pids[k] == 0) {
+            if (sim_cfg.replay_path) trace_replay_process(sim_cfg.replay_path, sim_cfg.replay_from_sec);
+            loadgen_run(&load_cfg, ipc_transport, k, &keep_running, NULL);
+            exit(0);
+        }
+    }
     
-    int current_lane_idx = 0;
+    // Event sources: vehicle arrivals and the timer wheel's timerfd
+    int epoll_fd = epoll_create1(0);
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    int arrival_fd = queue_notify_fd(global_mq);
+    struct epoll_event watch;
+    memset(&watch, 0, sizeof(watch));
+    watch.events = EPOLLIN;
+    watch.data.fd = timer_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &watch);
+    watch.data.fd = arrival_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, arrival_fd, &watch);
+
+    int64_t start_ns = monotonic_ns();
+    TimerWheel timers;
+    wheel_init(&timers, start_ns, SIM_MSEC(1));
+    WheelTimer live_timers[LIVE_TIMERS];
+    wheel_timer_init(&live_timers[LIVE_PHASE], 0);
+    // Periodic stats file
+    wheel_timer_init(&live_timers[LIVE_STATS], (int64_t)(stats_interval_sec * 1e9));
+    // Redraw between phase changes so the sensor estimates stay current
+    wheel_timer_init(&live_timers[LIVE_REFRESH], SIM_USEC(SENSOR_PERIOD_USEC) * 2);
+    for (int k = LIVE_STATS; k < LIVE_TIMERS; k++) {
+        if (live_timers[k].data > 0) wheel_schedule(&timers, &live_timers[k], start_ns + live_timers[k].data, k);
+    }
+    int64_t timer_fd_at = SIM_TIME_NEVER;
+    live_metrics = metrics_create(start_ns);
+
+    // If Emergency Lane: Process 1 car then rotate (RR for fairness among multiple emergencies)
+    // If Normal Lane: Process for GREEN_DURATION, but PREEMPT the moment an emergency arrives.
+    Controller ctl;
+    controller_init(&ctl, lane_queues, NULL, NULL); // This thread owns the lanes
+    ctl.intake = lane_intakes;
+    ctl.on_crossed = on_live_crossing;
+    ctl.hook_ctx = &ctl;
+    ctl.metrics = live_metrics;
+    ctl.scheduler = sim_cfg.scheduler;
+    ctl.conflicts = sim_cfg.conflicts;
+    ctl.timing.saturation_headway = (sim_time_t)(sim_cfg.headway_sec * 1e9);
+    ctl.sensors = lane_sensors;
+    CheckpointRestore restored;
+    int64_t restore_ns = 0;
+    int restored_ok = 0;
+    long long saved_phases = 0;
+    if (checkpointing) {
+        int64_t t0 = monotonic_ns();
+        restored_ok = checkpoint_restore(&live_checkpoint, &ctl, t0, &restored) == 0;
+        // The detectors never saw these arrive; without this the queue estimate would go negative
+        for (int i = 0; restored_ok && i < NUM_LANES; i++) sensor_count_restored(&lane_sensors[i], count_vehicles(&lane_queues[i]));
+        if (restored_ok && restored.vehicles > 0) controller_on_arrival(&ctl, monotonic_ns());
+        checkpoint_save(&live_checkpoint, &ctl, monotonic_ns()); // New baseline, the old log is folded in
+        restore_ns = monotonic_ns() - t0;
+        saved_phases = ctl.phases;
+    }
+    state_page = state_page_create(STATE_PAGE_NAME);
+    if (state_page == NULL) perror("state page: cannot create (monitors will not attach)");
+    else state_page_publish(state_page, &ctl, monotonic_ns());
+    Renderer renderer;
+    if (renderer_start(&renderer, STDOUT_FILENO, RENDER_MAX_FPS) != 0) {
+        fprintf(stderr, "renderer: cannot start\n");
+        keep_running = 0;
+    } else {
+        render(&renderer, 0, NULL);
+    }
     
-    // START MAIN LOOP
+    int refresh_due = 0;
+    // START MAIN LOOP: sleep until a vehicle arrives or a phase timer fires
     while (keep_running) {
-        check_mq_updates();
-        
-        int next_lane = select_next_lane(current_lane_idx);
-        
-        if (next_lane == -1) {
-            render(-1, NULL);
-            usleep(200000);
-            continue;
-        }
-
-        current_lane_idx = next_lane;
-        
-        // Check mode
-        pthread_mutex_lock(&queue_mutex);
-        int is_emergency_round = has_emergency(current_lane_idx);
-        pthread_mutex_unlock(&queue_mutex);
-        
-        // If Emergency Lane: Process 1 car then rotate (RR for fairness among multiple emergencies)
-        // If Normal Lane: Process for GREEN_DURATION, but PREEMPT if emergency appears elsewhere.
-        
-        time_t green_start = time(NULL);
-        int max_duration = is_emergency_round ? 0 : GREEN_DURATION_SEC; // 0 ensures at least 1 loop
-        
-        // GREEN LIGHT TIMER LOOP
-        while ( (is_emergency_round || (time(NULL) - green_start < max_duration)) && keep_running) {
-             check_mq_updates();
-
-             // PREEMPTION CHECK (For Normal Lanes)
-             if (!is_emergency_round) {
-                 pthread_mutex_lock(&queue_mutex);
-                 int emergency_exists = is_any_emergency_active();
-                 pthread_mutex_unlock(&queue_mutex);
-                 
-                 if (emergency_exists) {
-                     // Emergency appeared! Yield immediately.
-                     // (Render yellow/red transition will happen after break)
-                     break; 
-                 }
-             }
-
-             // Check if vehicles exist in green lane
-             Vehicle v_crossing = { -1 };
-             pthread_mutex_lock(&queue_mutex);
-             if (lane_queues[current_lane_idx] != NULL) {
-                 v_crossing = remove_vehicle(&lane_queues[current_lane_idx]);
-                 // Apply Aging to others
-                 for(int i=0; i<NUM_LANES; i++) handle_aging(&lane_queues[i]);
-             }
-             pthread_mutex_unlock(&queue_mutex);
-
-             if (v_crossing.id != -1) {
-                 // Animate Crossing
-                 render(current_lane_idx, &v_crossing);
-                 usleep(CROSSING_TIME_USEC);
-                 log_vehicle(v_crossing); // Add to history
-             } else {
-                 render(current_lane_idx, NULL);
-                 usleep(500000);
-                 break; // Empty
-             }
-             
-             // If this was an emergency round, we processed 1 car (or emptied). 
-             // Strictly break now to Rotate to next emergency (N->S->W...).
-             if (is_emergency_round) break;
-             
-             render(current_lane_idx, NULL);
-             usleep(200000); // brief pause between cars
-        }
-        
-        // Yellow/Red Transition
-        render(-1, NULL); 
-        usleep(1000000); // 1s all red safety
+        if (queue_prepare_wait(global_mq)) {
+            struct epoll_event fired[5];
+            TP_BEGIN("idle");
+            int n = epoll_wait(epoll_fd, fired, 5, -1);
+            TP_END("idle");
+            if (n < 0) n = 0; // Interrupted (Ctrl+C, SIGUSR1)
+            for (int i = 0; i < n; i++) {
+                if (fired[i].data.fd == timer_fd) {
+                    uint64_t expirations;
+                    if (read(timer_fd, &expirations, sizeof(expirations)) < 0) { /* Spurious */ }
+                    timer_fd_at = SIM_TIME_NEVER; // One-shot: now disarmed
+                } else {
+                    queue_ack_notify(global_mq);
+                }
+            }
+        }
+
+        sim_time_t now = monotonic_ns();
+        WheelTimer* due;
+        while ((due = wheel_peek(&timers)) != NULL && due->expires <= now) {
+            wheel_cancel(&timers, due);
+            if (due == &live_timers[LIVE_STATS]) stats_dump_requested = 1;
+            else if (due == &live_timers[LIVE_REFRESH]) refresh_due = 1;
+            if (due->data > 0) {
+                int64_t next = due->expires + due->data;
+                if (next <= now) next = now + due->data; // Fell behind: skip, do not burst
+                wheel_schedule(&timers, due, next, due->key);
+            }
+        }
+        int changed = refresh_due;
+        refresh_due = 0;
+        TP_BEGIN("check_mq_updates");
+        int received = check_mq_updates(&ctl);
+        TP_END("check_mq_updates");
+        TP_BEGIN("controller_on_arrival");
+        if (controller_collect_arrivals(&ctl) > 0 || received > 0) {
+            controller_on_arrival(&ctl, now);
+            changed = 1;
+        }
+        TP_END("controller_on_arrival");
+        while (ctl.deadline <= now) {
+            TP_BEGIN("controller_advance");
+            controller_advance(&ctl, now);
+            TP_END("controller_advance");
+            changed = 1;
+        }
+        // Snapshot at phase boundaries; the redo log covers the rest
+        if (checkpointing && (ctl.phases != saved_phases || checkpoint_log_full(&live_checkpoint))) {
+            TP_BEGIN("checkpoint_save");
+            checkpoint_save(&live_checkpoint, &ctl, now);
+            TP_END("checkpoint_save");
+            saved_phases = ctl.phases;
+        }
+        if (ctl.deadline != SIM_TIME_NEVER) wheel_schedule(&timers, &live_timers[LIVE_PHASE], ctl.deadline, LIVE_PHASE);
+        else wheel_cancel(&timers, &live_timers[LIVE_PHASE]);
+        int64_t next_timer = wheel_next_expiry(&timers);
+        if (next_timer != timer_fd_at) {
+            arm_timer_fd(timer_fd, next_timer);
+            timer_fd_at = next_timer;
+        }
+
+        if (changed) {
+            TP_BEGIN("render");
+            render(&renderer, ctl.green_mask, ctl.crossing);
+            TP_END("render");
+            TP_BEGIN("state_page_publish");
+            if (state_page) state_page_publish(state_page, &ctl, now);
+            TP_END("state_page_publish");
+        }
+        if (stats_dump_requested) {
+            stats_dump_requested = 0;
+            TP_BEGIN("write_stats");
+            write_stats();
+            TP_END("write_stats");
+        }
     }
     
+    renderer_stop(&renderer);
+    state_page_destroy(state_page, STATE_PAGE_NAME);
     disable_raw_mode(); 
     printf("\nShutting down...\n");
-    kill(generator_pid, SIGTERM);
-    wait(NULL);
+    close_tracepoints(tracepoints_path);
+    printf("Renderer: %lld updates, %lld frames, %.0f bytes/frame written\n", renderer.published,
+           renderer.frames_drawn, renderer.frames_drawn ? (double)renderer.bytes_written / renderer.frames_drawn : 0.0);
+    if (emergency_arrivals > 0) {
+        printf("Emergency detection latency: %lld vehicles, mean %.1f us, max %.1f us\n",
+               emergency_arrivals, emergency_latency_sum_ns / 1e3 / emergency_arrivals,
+               emergency_latency_max_ns / 1e3);
+    }
+    if (invalid_messages > 0) printf("Dropped %lld messages with an invalid lane or type\n", invalid_messages);
+    write_stats();
+    printf("Stats written to %s\n", stats_path);
+    if (recording) {
+        if (trace_writer_close(&live_record) != 0) perror("trace: write failed");
+        else printf("Recorded %llu vehicles to %s\n", (unsigned long long)live_record.header.vehicle_count, sim_cfg.record_path);
+    }
+    if (journaling) {
+        journaling = 0;
+        if (journal_close(&live_journal) != 0) perror("journal: write failed");
+        printf("Journal: %llu crossings written to %s, %llu dropped (writer behind), peak backlog %lld/%d, %lld syncs\n",
+               (unsigned long long)live_journal.header.record_count, sim_cfg.journal_path,
+               (unsigned long long)live_journal.header.dropped, atomic_load(&live_journal.peak_backlog),
+               JOURNAL_RING_CAPACITY, atomic_load(&live_journal.syncs));
+    }
+    for (int k = 0; k < generator_count; k++) kill(generator_pids[k], SIGTERM);
+    for (int k = 0; k < generator_count; k++) waitpid(generator_pids[k], NULL, 0);
+    if (checkpointing) {
+        // Generators are gone: whatever they sent goes into the final snapshot
+        while (check_mq_updates(&ctl) > 0) controller_collect_arrivals(&ctl);
+        controller_collect_arrivals(&ctl);
+        checkpoint_save(&live_checkpoint, &ctl, monotonic_ns());
+        checkpointing = 0;
+        if (restored_ok) {
+            printf("Checkpoint: restored %lld vehicles (%lld arrivals / %lld departures from the log, %lld unmatched) "
+                   "%.1f s after the snapshot, in %.2f ms\n", restored.vehicles, restored.logged_arrivals,
+                   restored.logged_departures, restored.missing, restored.age_sec, restore_ns / 1e6);
+        }
+        long long queued = 0;
+        for (int i = 0; i < NUM_LANES; i++) queued += count_vehicles(&lane_queues[i]);
+        printf("Checkpoint: %lld vehicles saved to %s, %lld snapshots (slowest %.2f ms), %lld log entries lost, %lld failed\n",
+               queued, checkpoint_path, live_checkpoint.snapshots, live_checkpoint.max_save_ns / 1e6,
+               live_checkpoint.log_lost, live_checkpoint.failed);
+        checkpoint_close(&live_checkpoint);
+    }
+    metrics_destroy(live_metrics);
+    close(timer_fd);
+    close(epoll_fd);
     
     cleanup_traffic_system();
     cleanup_queue(global_mq);
@@ -0,0 +1,180 @@
+#include "metrics.h"
+
+static const char* metric_names[METRIC_COUNT] = {
+    "queue_wait", "emergency_to_green", "preemption_reaction"
+};
+static const char* lane_names[NUM_LANES] = { "NORTH", "SOUTH", "EAST", "WEST" };
+static const char* type_names[NUM_VEHICLE_TYPES] = { "CAR", "AMBULANCE", "POLICE", "FIRE_TRUCK" };
+
+// ---------------- HDR Histogram ----------------
+
+static int hdr_index(uint64_t v) {
+    if (v < HDR_SUB_COUNT) return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    int shift = msb - HDR_SUB_BITS + 1;   // >= 1
+    int top = (int)(v >> shift);          // In [SUB_COUNT/2, SUB_COUNT)
+    return HDR_SUB_COUNT + (shift - 1) * (HDR_SUB_COUNT / 2) + (top - HDR_SUB_COUNT / 2);
+}
+
+// Highest value that maps to bucket `idx`
+static int64_t hdr_upper(int idx) {
+    if (idx < HDR_SUB_COUNT) return idx;
+    int rel = idx - HDR_SUB_COUNT;
+    int shift = rel / (HDR_SUB_COUNT / 2) + 1;
+    int64_t top = rel % (HDR_SUB_COUNT / 2) + HDR_SUB_COUNT / 2;
+    return ((top + 1) << shift) - 1;
+}
+
+void hdr_init(HdrHistogram* h) {
+    memset(h, 0, sizeof(*h));
+    h->min = INT64_MAX;
+}
+
+void hdr_record(HdrHistogram* h, int64_t value) {
+    if (value < 0) value = 0; // Clock skew across processes
+    if (value >= (1LL << HDR_MAX_BITS)) value = (1LL << HDR_MAX_BITS) - 1;
+    h->counts[hdr_index((uint64_t)value)]++;
+    h->total++;
+    h->sum += (double)value;
+    if (value < h->min) h->min = value;
+    if (value > h->max) h->max = value;
+}
+
+void hdr_merge(HdrHistogram* dst, const HdrHistogram* src) {
+    if (src->total == 0) return;
+    for (int i = 0; i < HDR_BUCKETS; i++) dst->counts[i] += src->counts[i];
+    dst->total += src->total;
+    dst->sum += src->sum;
+    if (src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max) dst->max = src->max;
+}
+
+int64_t hdr_percentile(const HdrHistogram* h, double percentile) {
+    if (h->total == 0) return 0;
+    double exact = percentile / 100.0 * h->total;
+    uint64_t rank = (uint64_t)exact;
+    if (rank < exact || rank == 0) rank++; // Round up: the rank-th smallest sample
+    uint64_t seen = 0;
+    for (int i = 0; i < HDR_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            int64_t v = hdr_upper(i);
+            return v > h->max ? h->max : v;
+        }
+    }
+    return h->max;
+}
+
+double hdr_mean(const HdrHistogram* h) {
+    return h->total ? h->sum / h->total : 0.0;
+}
+
+// ---------------- Metrics ----------------
+
+Metrics* metrics_create(int64_t now) {
+    Metrics* m = calloc(1, sizeof(Metrics));
+    if (m == NULL) return NULL;
+    for (int k = 0; k < METRIC_COUNT; k++)
+        for (int l = 0; l < NUM_LANES; l++)
+            for (int t = 0; t < NUM_VEHICLE_TYPES; t++) hdr_init(&m->hist[k][l][t]);
+    m->started_ns = now;
+    return m;
+}
+
+void metrics_destroy(Metrics* m) {
+    free(m);
+}
+
+static int valid_vehicle(const Vehicle* v) {
+    return v->lane >= 0 && v->lane < NUM_LANES && v->type >= 0 && v->type < NUM_VEHICLE_TYPES;
+}
+
+void metrics_record(Metrics* m, MetricKind kind, const Vehicle* v, int64_t value_ns) {
+    if (m == NULL || !valid_vehicle(v)) return;
+    hdr_record(&m->hist[kind][v->lane][v->type], value_ns);
+}
+
+void metrics_count_arrival(Metrics* m, const Vehicle* v) {
+    if (m == NULL || !valid_vehicle(v)) return;
+    m->arrivals[v->lane][v->type]++;
+}
+
+void metrics_count_crossing(Metrics* m, const Vehicle* v) {
+    if (m == NULL || !valid_vehicle(v)) return;
+    m->crossings[v->lane][v->type]++;
+}
+
+// ---------------- Reports ----------------
+
+static void write_hist_row(FILE* out, const char* metric, const char* lane, const char* type,
+                           const HdrHistogram* h) {
+    fprintf(out, "%s,%s,%s,%llu,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f\n", metric, lane, type,
+            (unsigned long long)h->total, hdr_mean(h) / 1e3,
+            hdr_percentile(h, 50.0) / 1e3, hdr_percentile(h, 99.0) / 1e3,
+            hdr_percentile(h, 99.9) / 1e3, h->total ? h->min / 1e3 : 0.0, h->max / 1e3);
+}
+
+// Two CSV tables: latency histograms (rows with samples only, plus an ALL
+// row per type) and throughput counters
+void metrics_write_csv(const Metrics* m, FILE* out, int64_t now) {
+    double uptime = (now - m->started_ns) / 1e9;
+    fprintf(out, "# uptime_sec=%.3f phases=%lld preemptions=%lld\n", uptime, m->phases, m->preemptions);
+
+    fprintf(out, "metric,lane,type,count,mean_us,p50_us,p99_us,p999_us,min_us,max_us\n");
+    for (int k = 0; k < METRIC_COUNT; k++) {
+        for (int t = 0; t < NUM_VEHICLE_TYPES; t++) {
+            HdrHistogram all;
+            hdr_init(&all);
+            for (int l = 0; l < NUM_LANES; l++) {
+                const HdrHistogram* h = &m->hist[k][l][t];
+                if (h->total == 0) continue;
+                write_hist_row(out, metric_names[k], lane_names[l], type_names[t], h);
+                hdr_merge(&all, h);
+            }
+            if (all.total > 0) write_hist_row(out, metric_names[k], "ALL", type_names[t], &all);
+        }
+    }
+
+    fprintf(out, "\nlane,type,arrivals,crossings,crossings_per_min\n");
+    for (int l = 0; l < NUM_LANES; l++) {
+        for (int t = 0; t < NUM_VEHICLE_TYPES; t++) {
+            fprintf(out, "%s,%s,%lld,%lld,%.2f\n", lane_names[l], type_names[t], m->arrivals[l][t],
+                    m->crossings[l][t], uptime > 0 ? m->crossings[l][t] * 60.0 / uptime : 0.0);
+        }
+    }
+}
+
+int metrics_write_file(const Metrics* m, const char* path, int64_t now) {
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE* f = fopen(tmp, "w");
+    if (f == NULL) return -1;
+    metrics_write_csv(m, f, now);
+    if (fclose(f) != 0) return -1;
+    return rename(tmp, path); // Readers never see a half-written file
+}
+
+static void print_summary_line(FILE* out, const char* label, const HdrHistogram* h) {
+    if (h->total == 0) return;
+    fprintf(out, "    %-11s n=%-7llu p50 %9.2f  p99 %9.2f  p99.9 %9.2f  max %9.2f\n", label,
+            (unsigned long long)h->total, hdr_percentile(h, 50.0) / 1e9, hdr_percentile(h, 99.0) / 1e9,
+            hdr_percentile(h, 99.9) / 1e9, h->max / 1e9);
+}
+
+// Percentiles per vehicle type, all lanes merged, in seconds
+void metrics_print_summary(const Metrics* m, FILE* out) {
+    for (int k = 0; k < METRIC_COUNT; k++) {
+        HdrHistogram* merged = malloc(sizeof(HdrHistogram) * NUM_VEHICLE_TYPES);
+        long long samples = 0;
+        for (int t = 0; t < NUM_VEHICLE_TYPES; t++) {
+            hdr_init(&merged[t]);
+            for (int l = 0; l < NUM_LANES; l++) hdr_merge(&merged[t], &m->hist[k][l][t]);
+            samples += merged[t].total;
+        }
+        if (samples > 0) {
+            fprintf(out, "  %s (s):\n", metric_names[k]);
+            for (int t = 0; t < NUM_VEHICLE_TYPES; t++) print_summary_line(out, type_names[t], &merged[t]);
+        }
+        free(merged);
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "utils.h"
+
+// HDR-style histogram: exact below 2^HDR_SUB_BITS, then each power of two
+// is split into 2^(HDR_SUB_BITS-1) linear sub-buckets, so every recorded
+// value keeps ~0.8% relative precision from nanoseconds up to ~3 days.
+#define HDR_SUB_BITS 7
+#define HDR_SUB_COUNT (1 << HDR_SUB_BITS)
+#define HDR_MAX_BITS 48 // Values are clamped to 2^48 - 1 ns
+#define HDR_BUCKETS (HDR_SUB_COUNT + (HDR_MAX_BITS - HDR_SUB_BITS) * (HDR_SUB_COUNT / 2))
+
+typedef struct {
+    uint64_t counts[HDR_BUCKETS];
+    uint64_t total;
+    int64_t min;
+    int64_t max;
+    double sum;
+} HdrHistogram;
+
+void hdr_init(HdrHistogram* h);
+void hdr_record(HdrHistogram* h, int64_t value);
+void hdr_merge(HdrHistogram* dst, const HdrHistogram* src);
+int64_t hdr_percentile(const HdrHistogram* h, double percentile); // 0..100
+double hdr_mean(const HdrHistogram* h);
+
+// Latency metrics, one histogram per lane and vehicle type
+typedef enum {
+    METRIC_QUEUE_WAIT,          // Arrival -> start of crossing
+    METRIC_EMERGENCY_TO_GREEN,  // Emergency arrival -> its lane's green
+    METRIC_PREEMPTION_REACTION, // Emergency arrival -> normal green cut
+    METRIC_COUNT
+} MetricKind;
+
+typedef struct {
+    HdrHistogram hist[METRIC_COUNT][NUM_LANES][NUM_VEHICLE_TYPES];
+
+    // Throughput counters
+    long long arrivals[NUM_LANES][NUM_VEHICLE_TYPES];
+    long long crossings[NUM_LANES][NUM_VEHICLE_TYPES];
+    long long phases;
+    long long preemptions;
+    int64_t started_ns;
+} Metrics;
+
+Metrics* metrics_create(int64_t now);
+void metrics_destroy(Metrics* m);
+void metrics_record(Metrics* m, MetricKind kind, const Vehicle* v, int64_t value_ns);
+void metrics_count_arrival(Metrics* m, const Vehicle* v);
+void metrics_count_crossing(Metrics* m, const Vehicle* v);
+
+// Reports
+void metrics_write_csv(const Metrics* m, FILE* out, int64_t now);
+int metrics_write_file(const Metrics* m, const char* path, int64_t now); // Atomic replace
+void metrics_print_summary(const Metrics* m, FILE* out);
+
+#endif
@@ -0,0 +1,470 @@
+#include "network.h"
+#include "spsc_ring.h"
+#include <sched.h>
+#include <math.h>
+#include <limits.h>
+
+#define LINK_RING_CAPACITY 4096
+#define DRAIN_EVERY 256 // Events between polls of the incoming links
+#define FIRST_VEHICLE_ID 1000
+#define SOURCE_MIN_GAP_SEC (3.0 * NUM_LANES) // Boundary arrivals: 3-6 s a lane, a quarter of the load
+
+struct Network;
+struct NetShard;
+
+typedef struct {
+    LaneQueue lanes[NUM_LANES];
+    Controller ctl;
+    WheelTimer ctl_timer;      // Next controller deadline (data = index)
+    uint64_t turn_rng;         // Routing decisions at this junction
+    uint64_t source_rng[NUM_LANES]; // Arrivals on boundary approaches
+    int source_count[NUM_LANES];    // Vehicles entered on each of them
+    int index;
+    int row;
+    int col;
+    struct NetShard* shard;
+} NetIntersection;
+
+// A vehicle in transit to an intersection owned by another shard
+typedef struct {
+    sim_time_t time;
+    int isect;
+    Vehicle v;
+} NetHandoff;
+
+typedef struct NetShard {
+    int id;
+    int first;                 // Owned intersections [first, last)
+    int last;
+    EventQueue events;
+    TimerWheel timers;         // Controller deadlines of the owned junctions
+    struct Network* net;
+
+    // Counters
+    long long entered;         // Arrivals from outside the grid
+    long long crossings;
+    long long exits;
+    long long handoffs;        // Vehicles sent to another shard
+    long long events_processed;
+    sim_time_t total_wait_ns;  // Arrival until clear of each junction
+} NetShard;
+
+typedef struct Network {
+    NetConfig cfg;
+    int count;
+    NetIntersection* isects;
+    int num_shards;
+    NetShard* shards;
+    SpscRing** links;          // [src * num_shards + dst], NULL if not adjacent
+    sim_time_t end;
+    sim_time_t window;
+    sim_time_t link_time;
+
+    _Alignas(CACHE_LINE) atomic_int barrier_count;
+    atomic_int barrier_gen;
+} Network;
+
+void network_default_config(NetConfig* cfg) {
+    cfg->rows = 16;
+    cfg->cols = 16;
+    cfg->threads = 4;
+    cfg->sweep = 0;
+    cfg->duration_sec = 3600.0;
+    cfg->seed = 1;
+    cfg->arrival_scale = 1.0;
+    cfg->link_sec = 20.0;
+    cfg->turn_ratio = 0.2;
+    cfg->conflicts = conflicts_through;
+}
+
+// ---------------- Routing ----------------
+
+// Direction of travel for vehicles waiting on each approach
+static const int heading_dr[NUM_LANES] = { +1, -1, 0, 0 }; // N->south, S->north, E->west, W->east
+static const int heading_dc[NUM_LANES] = { 0, 0, -1, +1 };
+
+// Approach a vehicle travelling (dr, dc) enters at the next junction
+static int entry_approach(int dr, int dc) {
+    if (dr > 0) return NORTH;
+    if (dr < 0) return SOUTH;
+    if (dc > 0) return WEST;
+    return EAST;
+}
+
+static int is_boundary_approach(const Network* net, const NetIntersection* x, int approach) {
+    switch (approach) {
+        case NORTH: return x->row == 0;
+        case SOUTH: return x->row == net->cfg.rows - 1;
+        case WEST: return x->col == 0;
+        default: return x->col == net->cfg.cols - 1;
+    }
+}
+
+// -1 when the vehicle leaves the grid
+static int route_vehicle(Network* net, NetIntersection* x, int approach, int* next_approach) {
+    int dr = heading_dr[approach];
+    int dc = heading_dc[approach];
+
+    if (net->cfg.turn_ratio > 0) {
+        double u = (sim_rand(&x->turn_rng) >> 11) * (1.0 / 9007199254740992.0);
+        if (u < net->cfg.turn_ratio) {
+            // Turn left or right: rotate the heading by +/-90 degrees
+            int t = dr;
+            if (u < net->cfg.turn_ratio / 2) { dr = -dc; dc = t; }
+            else { dr = dc; dc = -t; }
+        }
+    }
+
+    int row = x->row + dr;
+    int col = x->col + dc;
+    if (row < 0 || row >= net->cfg.rows || col < 0 || col >= net->cfg.cols) return -1;
+    *next_approach = entry_approach(dr, dc);
+    return row * net->cfg.cols + col;
+}
+
+// ---------------- Event Payloads ----------------
+
+static int64_t pack_arrival(int isect, const Vehicle* v) {
+    uint64_t bits = ((uint64_t)(uint32_t)v->id << 32) | ((uint64_t)v->type << 28) | ((uint64_t)v->lane << 24) | (uint64_t)isect;
+    return (int64_t)bits;
+}
+
+static void unpack_arrival(int64_t data, int* isect, Vehicle* v) {
+    memset(v, 0, sizeof(*v));
+    v->id = (int)(uint32_t)(data >> 32);
+    v->type = (int)((data >> 28) & 0xF);
+    v->lane = (int)((data >> 24) & 0xF);
+    *isect = (int)(data & 0xFFFFFF);
+}
+
+// Ties are broken by (arrivals before controller steps, junction, approach)
+// rather than insertion order, so the outcome does not depend on sharding.
+static uint64_t tie_key(int is_controller, int isect, int approach) {
+    return ((uint64_t)is_controller << 32) | ((uint64_t)isect << 2) | (uint64_t)approach;
+}
+
+static void schedule_arrival(NetShard* s, sim_time_t when, int isect, const Vehicle* v) {
+    schedule_event_keyed(&s->events, when, EV_ARRIVAL, pack_arrival(isect, v), tie_key(0, isect, v->lane));
+}
+
+static void schedule_controller(NetShard* s, NetIntersection* x, sim_time_t when) {
+    wheel_schedule(&s->timers, &x->ctl_timer, when, tie_key(1, x->index, 0));
+}
+
+// ---------------- Shard Worker ----------------
+
+static void drain_incoming(NetShard* s) {
+    Network* net = s->net;
+    NetHandoff batch[64];
+    for (int src = 0; src < net->num_shards; src++) {
+        SpscRing* ring = net->links[src * net->num_shards + s->id];
+        if (ring == NULL) continue;
+        size_t n;
+        while ((n = spsc_ring_pop_batch(ring, batch, 64)) > 0) {
+            for (size_t i = 0; i < n; i++) {
+                schedule_arrival(s, batch[i].time, batch[i].isect, &batch[i].v);
+            }
+        }
+    }
+}
+
+static void on_network_crossing(void* ctx, const Vehicle* v, sim_time_t now) {
+    NetIntersection* x = ctx;
+    NetShard* s = x->shard;
+    Network* net = s->net;
+
+    s->crossings++;
+    s->total_wait_ns += now - v->arrival_ns; // Includes the crossing itself
+
+    int next_approach;
+    int dest = route_vehicle(net, x, v->lane, &next_approach);
+    if (dest < 0) {
+        s->exits++;
+        return;
+    }
+
+    Vehicle moved = *v;
+    moved.lane = next_approach;
+    sim_time_t when = now + net->link_time;
+
+    NetShard* owner = net->isects[dest].shard;
+    if (owner == s) {
+        schedule_arrival(s, when, dest, &moved);
+        return;
+    }
+
+    NetHandoff h = { when, dest, moved };
+    SpscRing* ring = net->links[s->id * net->num_shards + owner->id];
+    while (spsc_ring_push(ring, &h) != 0) {
+        // Link full: keep our own inbound links moving so no cycle can stall
+        drain_incoming(s);
+        sched_yield();
+    }
+    s->handoffs++;
+}
+
+// Waits for every shard to finish the window, draining links meanwhile
+static void shard_barrier(NetShard* s) {
+    Network* net = s->net;
+    int gen = atomic_load(&net->barrier_gen);
+    if (atomic_fetch_add(&net->barrier_count, 1) + 1 == net->num_shards) {
+        atomic_store(&net->barrier_count, 0);
+        atomic_fetch_add(&net->barrier_gen, 1);
+        return;
+    }
+    while (atomic_load(&net->barrier_gen) == gen) {
+        drain_incoming(s);
+        sched_yield();
+    }
+}
+
+// Sources take turns through the id space (one round = every junction and
+// approach), so ids are unique across the grid and do not depend on how
+// the junctions are split between shards. run_network_simulation rejects
+// runs long enough to go past INT_MAX.
+static int source_vehicle_id(const Network* net, NetIntersection* x, int approach) {
+    int64_t sources = (int64_t)net->count * NUM_LANES;
+    return (int)(FIRST_VEHICLE_ID + x->source_count[approach]++ * sources + (int64_t)x->index * NUM_LANES + approach);
+}
+
+static void notify_arrival(NetShard* s, NetIntersection* x, sim_time_t now) {
+    if (controller_on_arrival(&x->ctl, now) && x->ctl.deadline != SIM_TIME_NEVER) {
+        schedule_controller(s, x, x->ctl.deadline);
+    }
+}
+
+static void handle_event(NetShard* s, const SimEvent* ev) {
+    Network* net = s->net;
+
+    if (ev->type == EV_SOURCE) {
+        NetIntersection* x = &net->isects[ev->data / NUM_LANES];
+        int approach = (int)(ev->data % NUM_LANES);
+        Vehicle v = sim_generate_vehicle(&x->source_rng[approach], source_vehicle_id(net, x, approach), ev->time);
+        v.lane = approach;
+        s->entered++;
+
+        add_vehicle(&x->lanes[approach], v);
+        notify_arrival(s, x, ev->time);
+
+        // Each boundary approach carries a quarter of a single intersection's load
+        sim_time_t gap = sim_next_arrival_gap(&x->source_rng[approach], net->cfg.arrival_scale) * NUM_LANES;
+        schedule_event_keyed(&s->events, ev->time + gap, EV_SOURCE, ev->data, tie_key(0, x->index, approach));
+    } else if (ev->type == EV_ARRIVAL) {
+        int isect;
+        Vehicle v;
+        unpack_arrival(ev->data, &isect, &v);
+        v.arrival_time = (time_t)(ev->time / SIM_SEC(1));
+        v.arrival_ns = ev->time;
+
+        NetIntersection* x = &net->isects[isect];
+        add_vehicle(&x->lanes[v.lane], v);
+        notify_arrival(s, x, ev->time);
+    }
+}
+
+static void fire_controller(NetShard* s, WheelTimer* t) {
+    NetIntersection* x = &s->net->isects[t->data];
+    sim_time_t now = t->expires;
+    wheel_cancel(&s->timers, t);
+    sim_time_t deadline = controller_advance(&x->ctl, now);
+    if (deadline != SIM_TIME_NEVER) schedule_controller(s, x, deadline);
+}
+
+static void* shard_worker(void* arg) {
+    NetShard* s = arg;
+    Network* net = s->net;
+
+    for (sim_time_t window_start = 0; window_start < net->end; ) {
+        sim_time_t window_end = window_start + net->window;
+        if (window_end > net->end) window_end = net->end;
+
+        drain_incoming(s);
+        SimEvent ev;
+        for (;;) {
+            WheelTimer* due = wheel_before_event(&s->timers, &s->events);
+            if ((due ? due->expires : event_queue_peek_time(&s->events)) >= window_end) break;
+            if (due) {
+                fire_controller(s, due);
+            } else {
+                next_event(&s->events, &ev);
+                handle_event(s, &ev);
+            }
+            if (++s->events_processed % DRAIN_EVERY == 0) drain_incoming(s);
+        }
+
+        shard_barrier(s);
+        window_start = window_end;
+    }
+    return NULL;
+}
+
+// ---------------- Setup / Teardown ----------------
+
+static uint64_t mix_seed(uint64_t seed, uint64_t salt) {
+    // splitmix64 finaliser: independent, non-zero streams per source
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL * (salt + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return z ? z : 1;
+}
+
+static void build_network(Network* net, const NetConfig* cfg, int num_shards) {
+    memset(net, 0, sizeof(*net));
+    net->cfg = *cfg;
+    net->count = cfg->rows * cfg->cols;
+    net->end = (sim_time_t)(cfg->duration_sec * 1e9);
+    net->link_time = (sim_time_t)(cfg->link_sec * 1e9);
+    net->window = net->link_time;
+    net->num_shards = num_shards;
+    atomic_init(&net->barrier_count, 0);
+    atomic_init(&net->barrier_gen, 0);
+
+    net->isects = calloc(net->count, sizeof(NetIntersection));
+    net->shards = calloc(num_shards, sizeof(NetShard));
+    net->links = calloc((size_t)num_shards * num_shards, sizeof(SpscRing*));
+
+    for (int k = 0; k < num_shards; k++) {
+        NetShard* s = &net->shards[k];
+        s->id = k;
+        s->first = (int)((long long)net->count * k / num_shards);
+        s->last = (int)((long long)net->count * (k + 1) / num_shards);
+        s->net = net;
+        event_queue_init(&s->events);
+        wheel_init(&s->timers, 0, SIM_MSEC(1));
+    }
+
+    for (int k = 0; k < num_shards; k++) {
+        NetShard* s = &net->shards[k];
+        for (int i = s->first; i < s->last; i++) {
+            NetIntersection* x = &net->isects[i];
+            x->index = i;
+            x->row = i / cfg->cols;
+            x->col = i % cfg->cols;
+            x->shard = s;
+            wheel_timer_init(&x->ctl_timer, i);
+            x->turn_rng = mix_seed(cfg->seed, (uint64_t)i * 8 + NUM_LANES);
+            controller_init(&x->ctl, x->lanes, NULL, NULL);
+            x->ctl.on_crossed = on_network_crossing;
+            x->ctl.hook_ctx = x;
+            x->ctl.conflicts = cfg->conflicts;
+
+            for (int a = 0; a < NUM_LANES; a++) {
+                x->source_rng[a] = mix_seed(cfg->seed, (uint64_t)i * 8 + a);
+                if (!is_boundary_approach(net, x, a)) continue;
+                sim_time_t first = sim_next_arrival_gap(&x->source_rng[a], cfg->arrival_scale) * NUM_LANES;
+                schedule_event_keyed(&s->events, first, EV_SOURCE, (int64_t)i * NUM_LANES + a, tie_key(0, i, a));
+            }
+        }
+    }
+
+    // One ring per ordered pair of shards that share a road
+    for (int i = 0; i < net->count; i++) {
+        NetIntersection* x = &net->isects[i];
+        for (int a = 0; a < NUM_LANES; a++) {
+            int row = x->row + heading_dr[a];
+            int col = x->col + heading_dc[a];
+            if (row < 0 || row >= cfg->rows || col < 0 || col >= cfg->cols) continue;
+            NetShard* dst = net->isects[row * cfg->cols + col].shard;
+            SpscRing** link = &net->links[x->shard->id * num_shards + dst->id];
+            if (dst != x->shard && *link == NULL) *link = spsc_ring_create(LINK_RING_CAPACITY, sizeof(NetHandoff));
+        }
+    }
+}
+
+static void destroy_network(Network* net) {
+    for (int i = 0; i < net->count; i++) {
+        for (int a = 0; a < NUM_LANES; a++) free_lane_queue(&net->isects[i].lanes[a]);
+    }
+    for (int k = 0; k < net->num_shards; k++) event_queue_free(&net->shards[k].events);
+    for (int k = 0; k < net->num_shards * net->num_shards; k++) {
+        if (net->links[k]) spsc_ring_destroy(net->links[k]);
+    }
+    free(net->links);
+    free(net->shards);
+    free(net->isects);
+}
+
+// ---------------- Runner ----------------
+
+typedef struct {
+    int threads;
+    double wall;
+    long long entered;
+    long long crossings;
+    long long exits;
+    long long handoffs;
+    long long events;
+    sim_time_t total_wait_ns;
+} NetResult;
+
+static void simulate(const NetConfig* cfg, int threads, NetResult* out) {
+    Network net;
+    build_network(&net, cfg, threads);
+
+    pthread_t* workers = malloc(sizeof(pthread_t) * threads);
+    double start = wall_seconds();
+    for (int k = 0; k < threads; k++) pthread_create(&workers[k], NULL, shard_worker, &net.shards[k]);
+    for (int k = 0; k < threads; k++) pthread_join(workers[k], NULL);
+    out->wall = wall_seconds() - start;
+    if (out->wall <= 0) out->wall = 1e-9;
+    free(workers);
+
+    out->threads = threads;
+    out->entered = out->crossings = out->exits = out->handoffs = out->events = out->total_wait_ns = 0;
+    for (int k = 0; k < threads; k++) {
+        NetShard* s = &net.shards[k];
+        out->entered += s->entered;
+        out->crossings += s->crossings;
+        out->exits += s->exits;
+        out->handoffs += s->handoffs;
+        out->events += s->events_processed;
+        out->total_wait_ns += s->total_wait_ns;
+    }
+    destroy_network(&net);
+}
+
+int run_network_simulation(const NetConfig* cfg) {
+    int count = cfg->rows * cfg->cols;
+    if (cfg->rows <= 0 || cfg->cols <= 0 || count >= (1 << 24)) {
+        fprintf(stderr, "network: grid must have between 1 and %d intersections\n", (1 << 24) - 1);
+        return -1;
+    }
+    if (cfg->duration_sec <= 0 || cfg->arrival_scale <= 0 || cfg->link_sec <= 0 || cfg->threads <= 0) {
+        fprintf(stderr, "network: duration, arrival scale, link time and threads must be positive\n");
+        return -1;
+    }
+    // Most vehicles one source can send: one per minimum gap (rounded up)
+    double per_source = ceil(cfg->duration_sec * cfg->arrival_scale / SOURCE_MIN_GAP_SEC) + 1;
+    if (FIRST_VEHICLE_ID + per_source * count * NUM_LANES > INT_MAX) {
+        fprintf(stderr, "network: %d intersections for %.0f s at arrival scale %.2f would run out of vehicle ids; "
+                "shorten the run or the grid\n", count, cfg->duration_sec, cfg->arrival_scale);
+        return -1;
+    }
+
+    int max_threads = cfg->threads < count ? cfg->threads : count;
+    printf("Network %dx%d (%d intersections), %.2f h simulated, link %.1f s, turn ratio %.2f\n",
+           cfg->rows, cfg->cols, count, cfg->duration_sec / 3600.0, cfg->link_sec, cfg->turn_ratio);
+    printf(" +---------+-----------+-------------+--------------+---------------+---------+\n");
+    printf(" | THREADS | WALL (s)  | CROSSINGS   | VEHICLES/S   | CROSS-SHARD   | SPEEDUP |\n");
+    printf(" +---------+-----------+-------------+--------------+---------------+---------+\n");
+
+    double base_rate = 0;
+    NetResult r;
+    for (int t = cfg->sweep ? 1 : max_threads; t <= max_threads; ) {
+        simulate(cfg, t, &r);
+        double rate = r.crossings / r.wall;
+        if (base_rate == 0) base_rate = rate;
+        printf(" | %-7d | %-9.3f | %-11lld | %-12.0f | %-13lld | %6.2fx |\n",
+               t, r.wall, r.crossings, rate, r.handoffs, rate / base_rate);
+
+        if (t == max_threads) break;
+        t = (t * 2 > max_threads) ? max_threads : t * 2;
+    }
+    printf(" +---------+-----------+-------------+--------------+---------------+---------+\n");
+    printf("  Vehicles: entered %lld, exited %lld, in network %lld; %lld events\n",
+           r.entered, r.exits, r.entered - r.exits, r.events);
+    printf("  Wait + cross   : mean %.3f s per junction (arrival until clear of the junction)\n",
+           r.crossings ? (double)r.total_wait_ns / r.crossings / 1e9 : 0.0);
+    return 0;
+}
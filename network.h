@@ -0,0 +1,32 @@
+#ifndef NETWORK_H
+#define NETWORK_H
+
+#include "sim.h"
+
+// Grid road network: rows x cols intersections, each with its own lanes and
+// controller. A vehicle that crosses is routed (straight, or turning with
+// turn_ratio) into the facing approach of the neighbouring intersection,
+// arriving link_sec later, or leaves the network at the grid edge.
+//
+// Intersections are split into contiguous shards, one per worker thread,
+// each running its own event queue. Shards advance in lock-step windows
+// of link_sec: nothing sent across a link can land inside the current
+// window, so vehicles crossing between shards travel over lock-free SPSC
+// rings and only a barrier per window is shared.
+typedef struct {
+    int rows;
+    int cols;
+    int threads;              // Worker threads (upper bound when sweeping)
+    int sweep;                // Run at 1, 2, 4 ... threads and compare
+    double duration_sec;      // Simulated time to cover
+    unsigned long long seed;
+    double arrival_scale;     // Multiplier on each boundary approach's arrival rate
+    double link_sec;          // Travel time between neighbours (and sync window)
+    double turn_ratio;        // Share of vehicles turning at each junction
+    const LaneMask* conflicts; // Which approaches may share a green
+} NetConfig;
+
+void network_default_config(NetConfig* cfg);
+int run_network_simulation(const NetConfig* cfg);
+
+#endif
@@ -0,0 +1,179 @@
+#include "renderer.h"
+#include <unistd.h>
+#include <errno.h>
+#include "tracepoint.h"
+
+#define CLEAR_SCREEN "\033[H\033[J"
+#define CLEAR_TO_EOL "\033[K"
+#define CLEAR_BELOW "\033[J"
+// Worst case: every line changed and each gets a cursor move + clear
+#define RENDER_OUT_BYTES (RENDER_FRAME_BYTES + RENDER_MAX_LINES * 32 + 64)
+
+static int draw_frame(RenderFrame* f, const SceneSnapshot* snap) {
+    FILE* mem = fmemopen(f->data, RENDER_FRAME_BYTES, "w");
+    if (mem == NULL) return -1;
+    draw_scene_snapshot(mem, snap);
+    fflush(mem);
+    long len = ftell(mem);
+    fclose(mem);
+    f->len = len > 0 ? (size_t)len : 0;
+    if (f->len >= RENDER_FRAME_BYTES) f->len = RENDER_FRAME_BYTES - 1; // Truncated frame
+    return 0;
+}
+
+// Splits a frame into lines (without the '\n'); returns the line count
+static int split_lines(const RenderFrame* f, const char** starts, size_t* lens) {
+    int n = 0;
+    const char* p = f->data;
+    const char* end = f->data + f->len;
+    while (p < end && n < RENDER_MAX_LINES) {
+        const char* nl = memchr(p, '\n', end - p);
+        const char* stop = nl ? nl : end;
+        starts[n] = p;
+        lens[n] = stop - p;
+        n++;
+        p = nl ? nl + 1 : end;
+    }
+    return n;
+}
+
+static size_t append(char* out, size_t at, const char* s, size_t len) {
+    memcpy(out + at, s, len);
+    return at + len;
+}
+
+// Terminal bytes that turn `prev` (NULL = unknown screen) into `cur`
+static size_t diff_frames(char* out, const RenderFrame* prev, const RenderFrame* cur) {
+    static const char* cur_starts[RENDER_MAX_LINES];
+    static size_t cur_lens[RENDER_MAX_LINES];
+    static const char* prev_starts[RENDER_MAX_LINES];
+    static size_t prev_lens[RENDER_MAX_LINES];
+
+    int cur_n = split_lines(cur, cur_starts, cur_lens);
+    int prev_n = prev ? split_lines(prev, prev_starts, prev_lens) : 0;
+    size_t at = 0;
+    if (prev == NULL) at = append(out, at, CLEAR_SCREEN, strlen(CLEAR_SCREEN));
+
+    for (int i = 0; i < cur_n; i++) {
+        if (prev && i < prev_n && prev_lens[i] == cur_lens[i] &&
+            memcmp(prev_starts[i], cur_starts[i], cur_lens[i]) == 0) {
+            continue; // Unchanged line
+        }
+        // Reset first: a line redrawn alone must not inherit the colour
+        // left by the line above it
+        char move[32];
+        int m = snprintf(move, sizeof(move), "\033[%d;1H" RESET, i + 1);
+        at = append(out, at, move, m);
+        at = append(out, at, cur_starts[i], cur_lens[i]);
+        at = append(out, at, CLEAR_TO_EOL, strlen(CLEAR_TO_EOL));
+    }
+    // Park the cursor under the frame (and clear what a longer frame left)
+    char move[32];
+    int m = snprintf(move, sizeof(move), "\033[%d;1H", cur_n + 1);
+    at = append(out, at, move, m);
+    if (prev && prev_n > cur_n) at = append(out, at, CLEAR_BELOW, strlen(CLEAR_BELOW));
+    return at;
+}
+
+static void write_all(Renderer* r, const char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(r->fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return; // Terminal gone: drop the frame
+        }
+        buf += n;
+        len -= n;
+        r->bytes_written += n;
+    }
+}
+
+static void* render_thread(void* arg) {
+    Renderer* r = arg;
+    int64_t period = 1000000000LL / (r->max_fps > 0 ? r->max_fps : RENDER_MAX_FPS);
+    SceneSnapshot snap;
+    TP_THREAD("renderer");
+
+    for (;;) {
+        pthread_mutex_lock(&r->lock);
+        while (!r->dirty && r->running) pthread_cond_wait(&r->wake, &r->lock);
+        if (!r->dirty) {
+            pthread_mutex_unlock(&r->lock);
+            break; // Stopped with nothing left to show
+        }
+        snap = r->pending;
+        r->dirty = 0;
+        int running = r->running;
+        pthread_mutex_unlock(&r->lock);
+
+        int64_t started = monotonic_ns();
+        int back = r->front ^ 1;
+        TP_BEGIN("draw_frame");
+        int drawn = draw_frame(&r->frames[back], &snap) == 0;
+        TP_END("draw_frame");
+        if (drawn) {
+            TP_BEGIN("write_frame");
+            size_t len = diff_frames(r->out, r->has_front ? &r->frames[r->front] : NULL, &r->frames[back]);
+            if (len > 0) write_all(r, r->out, len);
+            TP_END("write_frame");
+            r->front = back;
+            r->has_front = 1;
+            r->frames_drawn++;
+        }
+        if (!running) break;
+
+        // Frame cap: updates published meanwhile collapse into the next frame
+        while (sleep_until_ns(started + period) != 0) { /* EINTR */ }
+    }
+    return NULL;
+}
+
+int renderer_start(Renderer* r, int fd, int max_fps) {
+    memset(r, 0, sizeof(*r));
+    r->fd = fd;
+    r->max_fps = max_fps;
+    r->frames[0].data = malloc(RENDER_FRAME_BYTES);
+    r->frames[1].data = malloc(RENDER_FRAME_BYTES);
+    r->out = malloc(RENDER_OUT_BYTES);
+    if (!r->frames[0].data || !r->frames[1].data || !r->out) {
+        renderer_stop(r); // Not running yet: only frees
+        return -1;
+    }
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->wake, NULL);
+    r->running = 1;
+    if (pthread_create(&r->thread, NULL, render_thread, r) != 0) {
+        r->running = 0;
+        pthread_cond_destroy(&r->wake);
+        pthread_mutex_destroy(&r->lock);
+        renderer_stop(r);
+        return -1;
+    }
+    return 0;
+}
+
+void renderer_publish(Renderer* r, const SceneSnapshot* snap) {
+    TP_LOCK(&r->lock, "renderer");
+    r->pending = *snap;
+    r->dirty = 1;
+    r->published++;
+    pthread_cond_signal(&r->wake);
+    TP_UNLOCK(&r->lock, "renderer");
+}
+
+// Draws whatever is still pending, then joins the thread
+void renderer_stop(Renderer* r) {
+    if (r->running) {
+        pthread_mutex_lock(&r->lock);
+        r->running = 0;
+        pthread_cond_signal(&r->wake);
+        pthread_mutex_unlock(&r->lock);
+        pthread_join(r->thread, NULL);
+        pthread_cond_destroy(&r->wake);
+        pthread_mutex_destroy(&r->lock);
+    }
+    free(r->frames[0].data);
+    free(r->frames[1].data);
+    free(r->out);
+    r->frames[0].data = r->frames[1].data = r->out = NULL;
+}
@@ -0,0 +1,48 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include "utils.h"
+
+// Off-thread dashboard renderer
+// The controller publishes a SceneSnapshot (a short copy under `lock`) and
+// returns; the render thread draws it into an in-memory frame at most
+// max_fps times a second, diffs it against the previous frame line by line
+// and sends only the changed lines to the terminal in a single write().
+#define RENDER_MAX_FPS 30
+#define RENDER_FRAME_BYTES (64 * 1024)
+#define RENDER_MAX_LINES 256
+
+typedef struct {
+    char* data;
+    size_t len;
+} RenderFrame;
+
+typedef struct {
+    int fd;
+    int max_fps;
+    pthread_t thread;
+    pthread_mutex_t lock;   // Guards pending, dirty, running
+    pthread_cond_t wake;
+    SceneSnapshot pending;  // Latest published state
+    int dirty;
+    int running;
+
+    // Render thread only: double-buffered frames and the output buffer
+    RenderFrame frames[2];
+    int front;              // Index of the frame currently on screen
+    int has_front;
+    char* out;
+
+    // Counters
+    long long published;
+    long long frames_drawn;
+    long long bytes_written;
+} Renderer;
+
+int renderer_start(Renderer* r, int fd, int max_fps);
+void renderer_publish(Renderer* r, const SceneSnapshot* snap); // Never blocks on the terminal
+void renderer_stop(Renderer* r);
+
+#endif
@@ -0,0 +1,72 @@
+#include "sensor.h"
+#include <string.h>
+
+void sensor_init(LaneSensor* s, int64_t now) {
+    memset(s, 0, sizeof(*s));
+    atomic_init(&s->arrivals, 0);
+    atomic_init(&s->departures, 0);
+    atomic_init(&s->restored, 0);
+    atomic_init(&s->seq, 0);
+    s->last_ns = now;
+}
+
+void sensor_count_arrival(LaneSensor* s) {
+    atomic_fetch_add_explicit(&s->arrivals, 1, memory_order_relaxed);
+}
+
+void sensor_count_departure(LaneSensor* s) {
+    atomic_fetch_add_explicit(&s->departures, 1, memory_order_relaxed);
+}
+
+// Vehicles that were already waiting when the counters started (restored
+// from a checkpoint): they will depart, so the queue has to include them
+void sensor_count_restored(LaneSensor* s, long long n) {
+    atomic_fetch_add_explicit(&s->restored, n, memory_order_relaxed);
+}
+
+// Starts from zero rather than the first sample, so one early burst does
+// not read as a sustained rate
+static double ewma(double old, double sample) {
+    return old + SENSOR_ALPHA * (sample - old);
+}
+
+static void publish(LaneSensor* s) {
+    unsigned seq = atomic_load_explicit(&s->seq, memory_order_relaxed);
+    atomic_store_explicit(&s->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    s->published = s->state;
+    atomic_store_explicit(&s->seq, seq + 2, memory_order_release);
+}
+
+void sensor_sample(LaneSensor* s, int64_t now) {
+    double dt = (now - s->last_ns) / 1e9;
+    if (dt <= 0) return;
+
+    long long arrivals = atomic_load_explicit(&s->arrivals, memory_order_relaxed);
+    long long departures = atomic_load_explicit(&s->departures, memory_order_relaxed);
+    LaneEstimate* e = &s->state;
+
+    long long restored = atomic_load_explicit(&s->restored, memory_order_relaxed);
+    double queue = (double)(restored + arrivals - departures);
+    double previous_queue = e->queue_length;
+    e->arrival_rate = ewma(e->arrival_rate, (arrivals - e->arrivals) / dt);
+    e->discharge_rate = ewma(e->discharge_rate, (departures - e->departures) / dt);
+    e->queue_length = ewma(e->queue_length, queue);
+    e->queue_trend = ewma(e->queue_trend, (e->queue_length - previous_queue) / dt);
+    e->arrivals = arrivals;
+    e->departures = departures;
+    e->updated_ns = now;
+    s->last_ns = now;
+    publish(s);
+}
+
+// Retries while a sample is being published; the writer never waits on us
+void sensor_read(const LaneSensor* s, LaneEstimate* out) {
+    unsigned before, after;
+    do {
+        before = atomic_load_explicit(&s->seq, memory_order_acquire);
+        *out = s->published;
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&s->seq, memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
@@ -0,0 +1,46 @@
+#ifndef SENSOR_H
+#define SENSOR_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include "spsc_ring.h"
+
+// Per-lane demand estimator
+// Detectors only bump two counters (arrivals at the stop line, departures
+// through the junction). The lane's sensor thread samples them every
+// SENSOR_PERIOD_USEC, smooths rates and queue length with an EWMA and
+// publishes the result through a seqlock, so the controller and dashboard
+// read a consistent estimate without taking any lock.
+#define SENSOR_PERIOD_USEC 250000 // Sampling interval
+#define SENSOR_ALPHA 0.1          // EWMA weight of each new sample (~2.5 s time constant)
+
+typedef struct {
+    double arrival_rate;   // Vehicles/s joining the queue
+    double discharge_rate; // Vehicles/s leaving through the junction
+    double queue_length;   // Vehicles waiting (smoothed)
+    double queue_trend;    // Vehicles/s the queue grows (+) or shrinks (-)
+    long long arrivals;    // Totals at the last sample
+    long long departures;
+    int64_t updated_ns;    // Monotonic time of the last sample (0 = none yet)
+} LaneEstimate;
+
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_llong arrivals;   // Any thread
+    _Alignas(CACHE_LINE) atomic_llong departures; // Controller thread
+    atomic_llong restored;                        // Queued before counting began (checkpoint restore)
+    _Alignas(CACHE_LINE) atomic_uint seq;         // Odd while `published` is being written
+    LaneEstimate published;
+
+    // Sensor thread only
+    LaneEstimate state;
+    int64_t last_ns;
+} LaneSensor;
+
+void sensor_init(LaneSensor* s, int64_t now);
+void sensor_count_arrival(LaneSensor* s);
+void sensor_count_departure(LaneSensor* s);
+void sensor_count_restored(LaneSensor* s, long long n);         // In the queue, not in the arrival rate
+void sensor_sample(LaneSensor* s, int64_t now);                // Owning sensor thread only
+void sensor_read(const LaneSensor* s, LaneEstimate* out);      // Any thread, lock-free
+
+#endif
@@ -0,0 +1,505 @@
+#include "sim.h"
+#include "traffic_logic.h"
+
+// ---------------- Event Queue ----------------
+
+void event_queue_init(EventQueue* q) {
+    memset(q, 0, sizeof(*q));
+}
+
+void event_queue_free(EventQueue* q) {
+    free(q->heap);
+    memset(q, 0, sizeof(*q));
+}
+
+static int event_before(const SimEvent* a, const SimEvent* b) {
+    if (a->time != b->time) return a->time < b->time;
+    return a->seq < b->seq;
+}
+
+void schedule_event(EventQueue* q, sim_time_t when, int type, int64_t data) {
+    schedule_event_keyed(q, when, type, data, q->next_seq++);
+}
+
+void schedule_event_keyed(EventQueue* q, sim_time_t when, int type, int64_t data, uint64_t key) {
+    if (q->size == q->capacity) {
+        q->capacity = q->capacity ? q->capacity * 2 : 64;
+        q->heap = realloc(q->heap, q->capacity * sizeof(SimEvent));
+    }
+    SimEvent ev = { when, key, type, data };
+
+    // Sift up
+    size_t i = q->size++;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!event_before(&ev, &q->heap[parent])) break;
+        q->heap[i] = q->heap[parent];
+        i = parent;
+    }
+    q->heap[i] = ev;
+}
+
+sim_time_t event_queue_peek_time(const EventQueue* q) {
+    return q->size ? q->heap[0].time : SIM_TIME_NEVER;
+}
+
+int next_event(EventQueue* q, SimEvent* out) {
+    if (q->size == 0) return 1;
+    *out = q->heap[0];
+    q->now = out->time;
+
+    // Sift the last element down from the root
+    SimEvent last = q->heap[--q->size];
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= q->size) break;
+        if (child + 1 < q->size && event_before(&q->heap[child + 1], &q->heap[child])) child++;
+        if (!event_before(&q->heap[child], &last)) break;
+        q->heap[i] = q->heap[child];
+        i = child;
+    }
+    if (q->size > 0) q->heap[i] = last;
+    return 0;
+}
+
+WheelTimer* wheel_before_event(TimerWheel* w, const EventQueue* q) {
+    WheelTimer* t = wheel_peek(w);
+    if (t == NULL || q->size == 0) return t;
+    const SimEvent* head = &q->heap[0];
+    if (t->expires != head->time) return t->expires < head->time ? t : NULL;
+    return t->key < head->seq ? t : NULL;
+}
+
+// ---------------- Headless Runner ----------------
+
+typedef struct {
+    long long arrived;
+    long long crossed;
+    long long crossed_by_type[NUM_VEHICLE_TYPES];
+    sim_time_t total_wait_ns;  // Arrival until clear of the junction
+    sim_time_t max_wait_ns;
+    long long max_queued;
+    LaneSensor* sensors; // Departures feed the headless demand estimates
+    Journal* journal;    // Optional crossing journal
+    const Controller* ctl;
+} SimStats;
+
+// xorshift64*: small, fast and reproducible across platforms
+uint64_t sim_rand(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static void on_vehicle_crossed(void* ctx, const Vehicle* v, sim_time_t now) {
+    SimStats* st = ctx;
+    sim_time_t wait = now - v->arrival_ns; // Includes the crossing itself
+    st->crossed++;
+    if (v->type >= 0 && v->type < NUM_VEHICLE_TYPES) st->crossed_by_type[v->type]++;
+    st->total_wait_ns += wait;
+    if (wait > st->max_wait_ns) st->max_wait_ns = wait;
+    sensor_count_departure(&st->sensors[v->lane]);
+    if (st->journal) {
+        JournalRecord rec;
+        controller_journal_entry(st->ctl, v, now, &rec);
+        journal_append(st->journal, &rec);
+    }
+}
+
+// The original live generator's mix and 3-6 s spacing, on the virtual clock
+Vehicle sim_generate_vehicle(uint64_t* rng, int id, sim_time_t now) {
+    return sim_generate_vehicle_mix(rng, id, now, 10);
+}
+
+// Emergencies split 5:3:2 ambulance/police/fire, as in the original 10%
+Vehicle sim_generate_vehicle_mix(uint64_t* rng, int id, sim_time_t now, int emergency_percent) {
+    Vehicle v;
+    v.id = id;
+    v.lane = sim_rand(rng) % 4;
+
+    int r = sim_rand(rng) % 100;
+    if (r < emergency_percent * 5 / 10) v.type = AMBULANCE;
+    else if (r < emergency_percent * 8 / 10) v.type = POLICE;
+    else if (r < emergency_percent) v.type = FIRE_TRUCK;
+    else v.type = REGULAR_CAR;
+
+    v.arrival_time = (time_t)(now / SIM_SEC(1));
+    v.arrival_ns = now;
+    v.priority_score = 0;
+    return v;
+}
+
+sim_time_t sim_next_arrival_gap(uint64_t* rng, double scale) {
+    // Random arrival: 3s to 6s
+    sim_time_t gap = SIM_USEC((sim_rand(rng) % 3000000) + 3000000);
+    return (sim_time_t)(gap / scale);
+}
+
+double wall_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void sim_default_config(SimConfig* cfg) {
+    cfg->duration_sec = 24 * 3600.0;
+    cfg->seed = 1;
+    cfg->arrival_scale = 1.0;
+    cfg->stats_path = NULL;
+    cfg->scheduler = &scheduler_fixed;
+    cfg->conflicts = conflicts_through;
+    cfg->headway_sec = 0;
+    cfg->replay_path = NULL;
+    cfg->replay_from_sec = 0;
+    cfg->record_path = NULL;
+    cfg->journal_path = NULL;
+    cfg->green_sec = 0;
+    cfg->all_red_sec = 0;
+    cfg->aging_threshold = 0;
+    cfg->emergency_percent = 10;
+    for (int i = 0; i < NUM_LANES; i++) cfg->lane_weight[i] = 1.0;
+    cfg->compare_schedulers = 0;
+}
+
+static int lanes_weighted(const SimConfig* cfg) {
+    for (int i = 1; i < NUM_LANES; i++) {
+        if (cfg->lane_weight[i] != cfg->lane_weight[0]) return 1;
+    }
+    return 0;
+}
+
+static int pick_weighted_lane(uint64_t* rng, const double weight[]) {
+    double total = 0;
+    for (int i = 0; i < NUM_LANES; i++) total += weight[i];
+    double r = (sim_rand(rng) >> 11) * (1.0 / 9007199254740992.0) * total;
+    for (int i = 0; i < NUM_LANES - 1; i++) {
+        if (r < weight[i]) return i;
+        r -= weight[i];
+    }
+    return NUM_LANES - 1;
+}
+
+typedef struct {
+    SimStats stats;
+    Metrics* metrics;
+    long long processed;
+    long long phases;
+    long long preemptions;
+    double wall;
+} SimRun;
+
+// Next arrival from the trace, on the virtual clock (replay starts at 0)
+static int replay_next(TraceReader* replay, int64_t from_ns, TraceArrival* a) {
+    while (trace_next(replay, a) == 0) {
+        if (a->lane < 0 || a->lane >= NUM_LANES || a->type >= NUM_VEHICLE_TYPES) continue; // Corrupt record
+        a->offset_ns -= from_ns;
+        return 0;
+    }
+    return 1;
+}
+
+// One headless run on lanes of its own, so runs share no state.
+// Arrivals come from the generator, or from `replay` when given; `record`
+// (optional) captures them and `journal` (optional) the crossings.
+static void simulate(const SimConfig* cfg, SimRun* run, TraceReader* replay, TraceWriter* record, Journal* journal) {
+    memset(run, 0, sizeof(*run));
+    SimStats* stats = &run->stats;
+    LaneQueue lanes[NUM_LANES];
+    for (int i = 0; i < NUM_LANES; i++) {
+        init_lane_queue(&lanes[i]);
+        lanes[i].aging_threshold = cfg->aging_threshold;
+    }
+
+    LaneSensor sensors[NUM_LANES];
+    for (int i = 0; i < NUM_LANES; i++) sensor_init(&sensors[i], 0);
+    stats->sensors = sensors;
+
+    Controller ctl;
+    controller_init(&ctl, lanes, NULL, NULL); // Single-threaded
+    ctl.on_crossed = on_vehicle_crossed;
+    ctl.hook_ctx = stats;
+    stats->journal = journal;
+    stats->ctl = &ctl;
+    ctl.scheduler = cfg->scheduler;
+    ctl.conflicts = cfg->conflicts;
+    ctl.timing.saturation_headway = (sim_time_t)(cfg->headway_sec * 1e9);
+    if (cfg->green_sec > 0) ctl.timing.green_duration = (sim_time_t)(cfg->green_sec * 1e9);
+    if (cfg->all_red_sec > 0) ctl.timing.all_red = (sim_time_t)(cfg->all_red_sec * 1e9);
+    ctl.sensors = sensors;
+    run->metrics = metrics_create(0);
+    ctl.metrics = run->metrics;
+
+    EventQueue events;
+    event_queue_init(&events);
+    TimerWheel timers;
+    wheel_init(&timers, 0, SIM_MSEC(1));
+    WheelTimer ctl_timer, sensor_timer; // Keys continue the heap's insertion order
+    wheel_timer_init(&ctl_timer, 0);
+    wheel_timer_init(&sensor_timer, 0);
+
+    uint64_t rng = cfg->seed ? cfg->seed : 0x9E3779B97F4A7C15ULL;
+    sim_time_t end = (sim_time_t)(cfg->duration_sec * 1e9);
+    int weighted = lanes_weighted(cfg);
+    int next_id = 1000;
+
+    TraceArrival pending;
+    int64_t replay_from = (int64_t)(cfg->replay_from_sec * 1e9);
+    if (replay == NULL) {
+        schedule_event(&events, sim_next_arrival_gap(&rng, cfg->arrival_scale), EV_ARRIVAL, 0);
+    } else {
+        trace_seek(replay, replay_from);
+        end = replay->header.end_offset_ns - replay_from;
+        if (replay_next(replay, replay_from, &pending) == 0) schedule_event(&events, pending.offset_ns, EV_ARRIVAL, 0);
+    }
+    wheel_schedule(&timers, &sensor_timer, SIM_USEC(SENSOR_PERIOD_USEC), events.next_seq++);
+
+    double wall_start = wall_seconds();
+    SimEvent ev;
+    for (;;) {
+        WheelTimer* due = wheel_before_event(&timers, &events);
+        sim_time_t now = due ? due->expires : event_queue_peek_time(&events);
+        if (now == SIM_TIME_NEVER || now > end) break;
+        run->processed++;
+        if (due == &ctl_timer) {
+            wheel_cancel(&timers, due);
+            sim_time_t deadline = controller_advance(&ctl, now);
+            if (deadline != SIM_TIME_NEVER) wheel_schedule(&timers, &ctl_timer, deadline, events.next_seq++);
+            continue;
+        }
+        if (due == &sensor_timer) {
+            for (int i = 0; i < NUM_LANES; i++) sensor_sample(&sensors[i], now);
+            wheel_schedule(&timers, &sensor_timer, now + SIM_USEC(SENSOR_PERIOD_USEC), events.next_seq++);
+            continue;
+        }
+
+        next_event(&events, &ev);
+        if (ev.type == EV_ARRIVAL) {
+            Vehicle v;
+            if (replay == NULL) {
+                v = sim_generate_vehicle_mix(&rng, next_id++, ev.time, cfg->emergency_percent);
+                if (weighted) v.lane = pick_weighted_lane(&rng, cfg->lane_weight);
+            } else {
+                memset(&v, 0, sizeof(v));
+                v.id = pending.id;
+                v.lane = pending.lane;
+                v.type = pending.type;
+                v.arrival_time = (time_t)(ev.time / SIM_SEC(1));
+                v.arrival_ns = ev.time;
+            }
+            if (record) trace_write(record, ev.time, v.id, v.lane, v.type);
+            add_vehicle(&lanes[v.lane], v);
+            metrics_count_arrival(run->metrics, &v);
+            sensor_count_arrival(&sensors[v.lane]);
+
+            stats->arrived++;
+            long long queued = stats->arrived - stats->crossed;
+            if (queued > stats->max_queued) stats->max_queued = queued;
+
+            if (replay == NULL) {
+                schedule_event(&events, ev.time + sim_next_arrival_gap(&rng, cfg->arrival_scale), EV_ARRIVAL, 0);
+            } else if (replay_next(replay, replay_from, &pending) == 0) {
+                schedule_event(&events, pending.offset_ns, EV_ARRIVAL, 0);
+            }
+            if (controller_on_arrival(&ctl, ev.time) && ctl.deadline != SIM_TIME_NEVER) {
+                wheel_schedule(&timers, &ctl_timer, ctl.deadline, events.next_seq++);
+            }
+        }
+    }
+    run->wall = wall_seconds() - wall_start;
+    if (run->wall <= 0) run->wall = 1e-9;
+    run->phases = ctl.phases;
+    run->preemptions = ctl.preemptions;
+    stats->sensors = NULL;
+    stats->journal = NULL;
+    stats->ctl = NULL;
+
+    for (int i = 0; i < NUM_LANES; i++) free_lane_queue(&lanes[i]);
+    event_queue_free(&events);
+}
+
+// Queue wait (or emergency arrival-to-green) over every lane and vehicle type
+static void merged_histogram(const Metrics* m, MetricKind kind, HdrHistogram* out) {
+    hdr_init(out);
+    for (int lane = 0; lane < NUM_LANES; lane++) {
+        for (int type = 0; type < NUM_VEHICLE_TYPES; type++) hdr_merge(out, &m->hist[kind][lane][type]);
+    }
+}
+
+void sim_run_summary(const SimConfig* cfg, SimSummary* out) {
+    SimRun run;
+    simulate(cfg, &run, NULL, NULL, NULL);
+    HdrHistogram wait, to_green;
+    merged_histogram(run.metrics, METRIC_QUEUE_WAIT, &wait);
+    merged_histogram(run.metrics, METRIC_EMERGENCY_TO_GREEN, &to_green);
+    double hours = cfg->duration_sec > 0 ? cfg->duration_sec / 3600.0 : 1e-9;
+
+    memset(out, 0, sizeof(*out));
+    out->arrived = run.stats.arrived;
+    out->crossed = run.stats.crossed;
+    out->queued = run.stats.arrived - run.stats.crossed;
+    out->max_queued = run.stats.max_queued;
+    out->phases = run.phases;
+    out->preemptions = run.preemptions;
+    out->emergencies = (long long)to_green.total;
+    out->vehicles_per_hour = run.stats.crossed / hours;
+    out->wait_mean_sec = hdr_mean(&wait) / 1e9;
+    out->wait_p50_sec = hdr_percentile(&wait, 50.0) / 1e9;
+    out->wait_p95_sec = hdr_percentile(&wait, 95.0) / 1e9;
+    out->wait_p99_sec = hdr_percentile(&wait, 99.0) / 1e9;
+    out->wait_max_sec = wait.total ? wait.max / 1e9 : 0.0;
+    out->emergency_p50_sec = hdr_percentile(&to_green, 50.0) / 1e9;
+    out->emergency_p99_sec = hdr_percentile(&to_green, 99.0) / 1e9;
+    out->emergency_max_sec = to_green.total ? to_green.max / 1e9 : 0.0;
+    out->wall_sec = run.wall;
+    metrics_destroy(run.metrics);
+}
+
+int run_headless_simulation(const SimConfig* cfg) {
+    if (cfg->duration_sec <= 0 || cfg->arrival_scale <= 0) {
+        fprintf(stderr, "headless: duration and arrival scale must be positive\n");
+        return -1;
+    }
+    if (cfg->compare_schedulers) return run_scheduler_comparison(cfg);
+
+    TraceReader replay;
+    TraceWriter record;
+    if (cfg->replay_path && trace_reader_open(&replay, cfg->replay_path) != 0) {
+        fprintf(stderr, "headless: cannot replay %s (missing or not a trace)\n", cfg->replay_path);
+        return -1;
+    }
+    if (cfg->record_path && trace_writer_open(&record, cfg->record_path, 0, 0) != 0) {
+        perror("headless: cannot create trace");
+        if (cfg->replay_path) trace_reader_close(&replay);
+        return -1;
+    }
+    // Flat out on the virtual clock: wait for the writer rather than drop
+    Journal journal;
+    if (cfg->journal_path && journal_open(&journal, cfg->journal_path, 0, time(NULL), 1) != 0) {
+        perror("headless: cannot create journal");
+        if (cfg->replay_path) trace_reader_close(&replay);
+        if (cfg->record_path) trace_writer_close(&record);
+        return -1;
+    }
+
+    SimRun run;
+    simulate(cfg, &run, cfg->replay_path ? &replay : NULL, cfg->record_path ? &record : NULL,
+             cfg->journal_path ? &journal : NULL);
+    SimStats* stats = &run.stats;
+    double simulated = cfg->duration_sec;
+    if (cfg->replay_path) {
+        simulated = (replay.header.end_offset_ns - (int64_t)(cfg->replay_from_sec * 1e9)) / 1e9;
+        if (simulated < 0) simulated = 0;
+        printf("Replayed %s: %llu vehicles over %.2f h\n", cfg->replay_path,
+               (unsigned long long)replay.header.vehicle_count, replay.header.end_offset_ns / 3.6e12);
+        trace_reader_close(&replay);
+    }
+    if (cfg->record_path) {
+        if (trace_writer_close(&record) != 0) perror("headless: writing trace failed");
+        else printf("Recorded %llu vehicles to %s\n", (unsigned long long)record.header.vehicle_count, cfg->record_path);
+    }
+    if (cfg->journal_path) {
+        if (journal_close(&journal) != 0) perror("headless: writing journal failed");
+        else printf("Journaled %llu crossings to %s\n", (unsigned long long)journal.header.record_count, cfg->journal_path);
+    }
+
+    long long queued_now = stats->arrived - stats->crossed;
+    printf("Headless simulation complete (%s scheduler, %s)\n", cfg->scheduler->name,
+           cfg->headway_sec > 0 ? "batch discharge" : "one vehicle at a time");
+    printf("  Simulated time : %.1f s (%.2f h)\n", simulated, simulated / 3600.0);
+    printf("  Wall time      : %.3f s (%.0fx real time)\n", run.wall, simulated / run.wall);
+    printf("  Events         : %lld (%.2f M events/s)\n", run.processed, run.processed / run.wall / 1e6);
+    printf("  Vehicles       : arrived %lld, crossed %lld, still queued %lld (peak %lld)\n",
+           stats->arrived, stats->crossed, queued_now, stats->max_queued);
+    printf("  Crossed by type: CAR %lld | AMB %lld | POL %lld | FIRE %lld\n",
+           stats->crossed_by_type[REGULAR_CAR], stats->crossed_by_type[AMBULANCE],
+           stats->crossed_by_type[POLICE], stats->crossed_by_type[FIRE_TRUCK]);
+    printf("  Wait + cross   : mean %.3f s, max %.3f s (arrival until clear of the junction)\n",
+           stats->crossed ? (double)stats->total_wait_ns / stats->crossed / 1e9 : 0.0, stats->max_wait_ns / 1e9);
+    printf("  Phases         : %lld (%lld preempted by emergencies)\n", run.phases, run.preemptions);
+    metrics_print_summary(run.metrics, stdout);
+    if (cfg->stats_path && metrics_write_file(run.metrics, cfg->stats_path, (sim_time_t)(simulated * 1e9)) != 0) {
+        perror("headless: writing stats file failed");
+    }
+
+    metrics_destroy(run.metrics);
+    return 0;
+}
+
+typedef struct {
+    const char* name;
+    double scale;                // On top of the configured arrival scale
+    double weight[NUM_LANES];
+} SchedulerScenario;
+
+static const SchedulerScenario scheduler_scenarios[] = {
+    { "balanced",      1.0, { 1, 1, 1, 1 } },
+    { "balanced-peak", 1.8, { 1, 1, 1, 1 } },
+    { "one-heavy",     1.8, { 5, 1, 1, 1 } },
+    { "corridor",      1.8, { 3, 3, 1, 1 } },
+    { "near-capacity", 2.2, { 3, 3, 1, 1 } },
+    { "saturated",     2.5, { 1, 1, 1, 1 } },
+    { "paired-limit",  4.0, { 1, 1, 1, 1 } },
+};
+
+// A replayed trace is the only scenario: its arrivals are fixed
+static const SchedulerScenario trace_scenario = { "trace", 1.0, { 1, 1, 1, 1 } };
+
+int run_scheduler_comparison(const SimConfig* cfg) {
+    const SchedulerPolicy* policies[] = { &scheduler_fixed, &scheduler_max_pressure };
+    const LaneMask* phasings[] = { conflicts_exclusive, conflicts_through };
+    const char* phasing_names[] = { "single", "paired" };
+    const SchedulerScenario* scenarios = scheduler_scenarios;
+    int scenario_count = sizeof(scheduler_scenarios) / sizeof(scheduler_scenarios[0]);
+    double hours = cfg->duration_sec / 3600.0;
+
+    TraceReader replay;
+    if (cfg->replay_path) {
+        if (trace_reader_open(&replay, cfg->replay_path) != 0) {
+            fprintf(stderr, "headless: cannot replay %s (missing or not a trace)\n", cfg->replay_path);
+            return -1;
+        }
+        scenarios = &trace_scenario;
+        scenario_count = 1;
+        hours = (replay.header.end_offset_ns - cfg->replay_from_sec * 1e9) / 3.6e12;
+        printf("Scheduler comparison on %s: %llu vehicles, %.2f h replayed per run, headway %.2f s\n",
+               cfg->replay_path, (unsigned long long)replay.header.vehicle_count, hours, cfg->headway_sec);
+    } else {
+        printf("Scheduler comparison: %.2f h simulated per run, seed %llu, arrival scale x%.2f, headway %.2f s\n",
+               hours, cfg->seed, cfg->arrival_scale, cfg->headway_sec);
+    }
+    if (hours <= 0) hours = 1e-9;
+    printf("  single = one approach per green (legacy), paired = conflict matrix (North+South, East+West)\n");
+    printf(" +---------------+--------------+---------+----------+-----------+-----------+------------+---------+\n");
+    printf(" | SCENARIO      | POLICY       | PHASING | VEH/H    | MEAN WAIT | P99 WAIT  | EMERG P99  | QUEUED  |\n");
+    printf(" +---------------+--------------+---------+----------+-----------+-----------+------------+---------+\n");
+    for (int s = 0; s < scenario_count; s++) {
+        const SchedulerScenario* sc = &scenarios[s];
+        for (int p = 0; p < 2; p++) {
+            for (int ph = 0; ph < 2; ph++) {
+                SimConfig run_cfg = *cfg;
+                run_cfg.arrival_scale = cfg->arrival_scale * sc->scale;
+                run_cfg.scheduler = policies[p];
+                run_cfg.conflicts = phasings[ph];
+                memcpy(run_cfg.lane_weight, sc->weight, sizeof(run_cfg.lane_weight));
+
+                SimRun run;
+                simulate(&run_cfg, &run, cfg->replay_path ? &replay : NULL, NULL, NULL);
+                HdrHistogram wait, to_green;
+                merged_histogram(run.metrics, METRIC_QUEUE_WAIT, &wait);
+                merged_histogram(run.metrics, METRIC_EMERGENCY_TO_GREEN, &to_green);
+                printf(" | %-13s | %-12s | %-7s | %-8.0f | %7.1f s | %7.1f s | %8.1f s | %-7lld |\n",
+                       sc->name, policies[p]->name, phasing_names[ph], run.stats.crossed / hours,
+                       hdr_mean(&wait) / 1e9, hdr_percentile(&wait, 99.0) / 1e9,
+                       hdr_percentile(&to_green, 99.0) / 1e9, run.stats.arrived - run.stats.crossed);
+                metrics_destroy(run.metrics);
+            }
+        }
+    }
+    printf(" +---------------+--------------+---------+----------+-----------+-----------+------------+---------+\n");
+    if (cfg->replay_path) trace_reader_close(&replay);
+    return 0;
+}
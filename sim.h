@@ -0,0 +1,102 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include "controller.h"
+#include "trace.h"
+#include "timer_wheel.h"
+
+// Discrete-event scheduler on a virtual clock
+typedef enum {
+    EV_ARRIVAL,    // Generator produces a vehicle
+    EV_SOURCE      // Boundary source due to emit its next vehicle (network)
+} SimEventType;
+
+typedef struct {
+    sim_time_t time;
+    uint64_t seq;  // Tie-breaker: FIFO among events at the same instant (or explicit key)
+    int type;
+    int64_t data;
+} SimEvent;
+
+typedef struct {
+    SimEvent* heap; // Binary min-heap on (time, seq)
+    size_t size;
+    size_t capacity;
+    uint64_t next_seq;
+    sim_time_t now;
+} EventQueue;
+
+void event_queue_init(EventQueue* q);
+void event_queue_free(EventQueue* q);
+void schedule_event(EventQueue* q, sim_time_t when, int type, int64_t data);
+// Explicit tie-breaker instead of insertion order, for runs that must not
+// depend on the order events were inserted in (e.g. across shards)
+void schedule_event_keyed(EventQueue* q, sim_time_t when, int type, int64_t data, uint64_t key);
+int next_event(EventQueue* q, SimEvent* out); // 0 = ok, 1 = empty
+sim_time_t event_queue_peek_time(const EventQueue* q); // SIM_TIME_NEVER if empty
+
+// Timers that are re-armed rather than accumulated (controller deadlines,
+// periodic samples) live on a timing wheel next to the heap. Both order by
+// (time, key); this returns the wheel's earliest timer if it goes before the
+// heap's next event, else NULL.
+WheelTimer* wheel_before_event(TimerWheel* w, const EventQueue* q);
+
+// Arrival model shared by the headless runners
+uint64_t sim_rand(uint64_t* state);
+Vehicle sim_generate_vehicle(uint64_t* rng, int id, sim_time_t now);
+// Same, with `emergency_percent` of arrivals emergency vehicles (default 10)
+Vehicle sim_generate_vehicle_mix(uint64_t* rng, int id, sim_time_t now, int emergency_percent);
+sim_time_t sim_next_arrival_gap(uint64_t* rng, double scale);
+double wall_seconds();
+
+// Headless run configuration
+typedef struct {
+    double duration_sec;      // Simulated time to cover
+    unsigned long long seed;  // Arrival generator seed
+    double arrival_scale;     // Multiplier on the default arrival rate
+    const char* stats_path;   // Metrics CSV written at the end (NULL = none)
+    const SchedulerPolicy* scheduler;  // Normal green policy
+    const LaneMask* conflicts;         // Which approaches may share a green
+    double headway_sec;                // Saturation headway for batch discharge (0 = one vehicle at a time)
+    double lane_weight[NUM_LANES];     // Relative arrival share per lane (all equal = uniform)
+    int compare_schedulers;            // Run the scheduler scenario set instead
+    const char* replay_path;           // Arrivals from this trace instead of the generator
+    double replay_from_sec;            // Start the replay this far into the trace
+    const char* record_path;           // Capture every arrival to this trace
+    const char* journal_path;          // Crossing journal (see journal.h; NULL = none)
+    double green_sec;                  // Normal green (0 = GREEN_DURATION_SEC)
+    double all_red_sec;                // All-red interval (0 = ALL_RED_USEC)
+    int aging_threshold;               // Aging passes before a car is served as urgent (0 = AGING_THRESHOLD)
+    int emergency_percent;             // Share of generated arrivals that are emergency vehicles
+} SimConfig;
+
+// Outcome of one run, for runners that compare many
+typedef struct {
+    long long arrived;
+    long long crossed;
+    long long queued;          // Still waiting at the end
+    long long max_queued;
+    long long phases;
+    long long preemptions;
+    long long emergencies;     // Emergency vehicles that got their green
+    double vehicles_per_hour;
+    double wait_mean_sec;      // Arrival -> start of crossing, every vehicle
+    double wait_p50_sec;
+    double wait_p95_sec;
+    double wait_p99_sec;
+    double wait_max_sec;
+    double emergency_p50_sec;  // Emergency arrival -> its lane's green
+    double emergency_p99_sec;
+    double emergency_max_sec;
+    double wall_sec;
+} SimSummary;
+
+void sim_default_config(SimConfig* cfg);
+int run_headless_simulation(const SimConfig* cfg);
+// One generated run (no trace, stats file or journal) on lanes of its own,
+// so any number may run at once on different threads
+void sim_run_summary(const SimConfig* cfg, SimSummary* out);
+// Every policy against balanced, unbalanced and saturated demand
+int run_scheduler_comparison(const SimConfig* cfg);
+
+#endif
@@ -0,0 +1,84 @@
+#include "spsc_ring.h"
+#include <stdlib.h>
+#include <string.h>
+
+static size_t round_pow2(size_t n) {
+    size_t cap = 2;
+    while (cap < n) cap <<= 1;
+    return cap;
+}
+
+size_t spsc_ring_bytes(size_t capacity, size_t elem_size) {
+    return sizeof(SpscRing) + round_pow2(capacity) * elem_size;
+}
+
+SpscRing* spsc_ring_init(void* mem, size_t capacity, size_t elem_size) {
+    SpscRing* r = (SpscRing*)mem;
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    r->cached_head = 0;
+    r->cached_tail = 0;
+    r->mask = round_pow2(capacity) - 1;
+    r->elem_size = elem_size;
+    return r;
+}
+
+SpscRing* spsc_ring_create(size_t capacity, size_t elem_size) {
+    void* mem = aligned_alloc(CACHE_LINE, (spsc_ring_bytes(capacity, elem_size) + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1));
+    if (mem == NULL) return NULL;
+    return spsc_ring_init(mem, capacity, elem_size);
+}
+
+void spsc_ring_destroy(SpscRing* r) {
+    free(r);
+}
+
+size_t spsc_ring_push_batch(SpscRing* r, const void* elems, size_t n) {
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    size_t capacity = r->mask + 1;
+
+    // Only re-read the consumer's index when the cached view says full
+    if (capacity - (tail - r->cached_head) < n) {
+        r->cached_head = atomic_load_explicit(&r->head, memory_order_acquire);
+    }
+    size_t space = capacity - (tail - r->cached_head);
+    if (n > space) n = space;
+
+    const unsigned char* src = (const unsigned char*)elems;
+    for (size_t i = 0; i < n; i++) {
+        memcpy(&r->data[((tail + i) & r->mask) * r->elem_size], src + i * r->elem_size, r->elem_size);
+    }
+    atomic_store_explicit(&r->tail, tail + n, memory_order_release);
+    return n;
+}
+
+int spsc_ring_push(SpscRing* r, const void* elem) {
+    return spsc_ring_push_batch(r, elem, 1) == 1 ? 0 : 1;
+}
+
+size_t spsc_ring_pop_batch(SpscRing* r, void* out, size_t max) {
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+
+    if (r->cached_tail - head < max) {
+        r->cached_tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    }
+    size_t avail = r->cached_tail - head;
+    if (max > avail) max = avail;
+
+    unsigned char* dst = (unsigned char*)out;
+    for (size_t i = 0; i < max; i++) {
+        memcpy(dst + i * r->elem_size, &r->data[((head + i) & r->mask) * r->elem_size], r->elem_size);
+    }
+    atomic_store_explicit(&r->head, head + max, memory_order_release);
+    return max;
+}
+
+int spsc_ring_pop(SpscRing* r, void* elem) {
+    return spsc_ring_pop_batch(r, elem, 1) == 1 ? 0 : 1;
+}
+
+size_t spsc_ring_size(SpscRing* r) {
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    return tail - head;
+}
@@ -0,0 +1,42 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#define CACHE_LINE 64
+
+// Single-producer/single-consumer ring of fixed-size records.
+// Lock-free: the producer only writes `tail`, the consumer only writes
+// `head`, each on its own cache line. The records follow the header in
+// the same block and nothing inside is a pointer, so a ring can live in
+// shared memory as well as on the heap.
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_size_t head; // Next record to read (consumer)
+    size_t cached_tail;                       // Consumer's last view of tail
+
+    _Alignas(CACHE_LINE) atomic_size_t tail; // Next record to write (producer)
+    size_t cached_head;                       // Producer's last view of head
+
+    _Alignas(CACHE_LINE) size_t mask;        // Capacity - 1 (power of two)
+    size_t elem_size;
+
+    _Alignas(CACHE_LINE) unsigned char data[];
+} SpscRing;
+
+size_t spsc_ring_bytes(size_t capacity, size_t elem_size); // Block size for spsc_ring_init
+SpscRing* spsc_ring_init(void* mem, size_t capacity, size_t elem_size);
+SpscRing* spsc_ring_create(size_t capacity, size_t elem_size);
+void spsc_ring_destroy(SpscRing* r);
+
+// Producer side: 0 = ok, 1 = full / number of records actually pushed
+int spsc_ring_push(SpscRing* r, const void* elem);
+size_t spsc_ring_push_batch(SpscRing* r, const void* elems, size_t n);
+
+// Consumer side: 0 = ok, 1 = empty / number of records actually popped
+int spsc_ring_pop(SpscRing* r, void* elem);
+size_t spsc_ring_pop_batch(SpscRing* r, void* out, size_t max);
+
+size_t spsc_ring_size(SpscRing* r); // Approximate when called concurrently
+
+#endif
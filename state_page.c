@@ -0,0 +1,126 @@
+#include "state_page.h"
+#include <sched.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+StatePage* state_page_create(const char* name) {
+    shm_unlink(name); // A crashed controller's page is stale
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd == -1) return NULL;
+    if (ftruncate(fd, sizeof(StatePage)) == -1) {
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    void* map = mmap(NULL, sizeof(StatePage), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        shm_unlink(name);
+        return NULL;
+    }
+
+    StatePage* p = map; // Zero-filled by ftruncate
+    p->version = STATE_PAGE_VERSION;
+    p->page_bytes = sizeof(StatePage);
+    p->writer_pid = (int32_t)getpid();
+    p->started_ns = monotonic_ns();
+    atomic_init(&p->live, 1);
+    atomic_init(&p->seq, 0);
+    p->snapshot.deadline_ns = SIM_TIME_NEVER;
+    for (int i = 0; i < NUM_LANES; i++) p->snapshot.lanes[i].crossing.id = -1;
+    atomic_thread_fence(memory_order_release);
+    p->magic = STATE_PAGE_MAGIC; // Last: readers check it before anything else
+    return p;
+}
+
+static void copy_vehicle(StateVehicle* out, const Vehicle* v) {
+    out->id = v->id;
+    out->type = v->type;
+    out->arrival_ns = v->arrival_ns;
+}
+
+void state_page_publish(StatePage* p, const Controller* c, int64_t now) {
+    // Built off to the side, so the odd (busy) window is one short copy
+    StateSnapshot s;
+    memset(&s, 0, sizeof(s));
+    s.updated_ns = now;
+    s.updates = p->snapshot.updates + 1;
+    s.phase = c->state;
+    s.green_mask = c->green_mask;
+    s.lead_lane = c->current_lane_idx;
+    s.emergency_round = c->is_emergency_round;
+    s.green_start_ns = c->green_start;
+    s.deadline_ns = c->deadline;
+    s.phases = c->phases;
+    s.preemptions = c->preemptions;
+    for (int i = 0; i < NUM_LANES; i++) {
+        const LaneQueue* q = &c->lanes[i];
+        StateLane* l = &s.lanes[i];
+        l->count = count_vehicles(q);
+        l->emergencies = count_vehicles(q) - count_vehicles_of_type(q, REGULAR_CAR);
+        if (c->green_mask & (1u << i)) {
+            l->flow = c->flow[i];
+            l->flow_deadline_ns = c->flow_deadline[i];
+        }
+        if (c->sensors) {
+            l->arrivals = atomic_load_explicit(&c->sensors[i].arrivals, memory_order_relaxed);
+            l->departures = atomic_load_explicit(&c->sensors[i].departures, memory_order_relaxed);
+        }
+        copy_vehicle(&l->crossing, &c->crossing[i]);
+        Vehicle head[STATE_PAGE_WINDOW];
+        l->head_count = peek_vehicles(q, head, STATE_PAGE_WINDOW);
+        for (int k = 0; k < l->head_count; k++) copy_vehicle(&l->head[k], &head[k]);
+    }
+
+    unsigned seq = atomic_load_explicit(&p->seq, memory_order_relaxed);
+    atomic_store_explicit(&p->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    p->snapshot = s;
+    atomic_store_explicit(&p->seq, seq + 2, memory_order_release);
+}
+
+void state_page_destroy(StatePage* p, const char* name) {
+    if (p == NULL) return;
+    atomic_store(&p->live, 0);
+    munmap(p, sizeof(StatePage));
+    shm_unlink(name);
+}
+
+const StatePage* state_page_attach(const char* name) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd == -1) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size != sizeof(StatePage)) {
+        close(fd);
+        return NULL;
+    }
+    void* map = mmap(NULL, sizeof(StatePage), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+    const StatePage* p = map;
+    if (p->magic != STATE_PAGE_MAGIC || p->version != STATE_PAGE_VERSION || p->page_bytes != sizeof(StatePage)) {
+        munmap(map, sizeof(StatePage));
+        return NULL;
+    }
+    return p;
+}
+
+// Retries while a snapshot is being published; the writer never waits on us
+int state_page_read(const StatePage* p, StateSnapshot* out) {
+    unsigned before, after;
+    for (int retries = 0; retries < STATE_PAGE_MAX_RETRIES; retries++) {
+        before = atomic_load_explicit(&p->seq, memory_order_acquire);
+        *out = p->snapshot;
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&p->seq, memory_order_relaxed);
+        if (!(before & 1) && before == after) return retries;
+        sched_yield(); // The writer may share our CPU
+    }
+    return -1;
+}
+
+void state_page_detach(const StatePage* p) {
+    munmap((void*)p, sizeof(StatePage));
+}
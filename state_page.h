@@ -0,0 +1,76 @@
+#ifndef STATE_PAGE_H
+#define STATE_PAGE_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "controller.h"
+
+// Shared-memory state page
+// The live controller publishes what the dashboard shows (lane counts, the
+// first vehicles of each lane, the green set, phase timers and counters)
+// into a POSIX shm segment under a seqlock. Monitors, exporters and
+// watchdogs map it read-only and copy a consistent snapshot without a lock;
+// the controller never waits on them, however many there are or however
+// often they read.
+#define STATE_PAGE_NAME "/traffic_state"
+#define STATE_PAGE_MAGIC 0x3145544154535254ULL // "TRSTATE1"
+#define STATE_PAGE_VERSION 1
+#define STATE_PAGE_WINDOW 8          // Head-of-queue vehicles per lane
+#define STATE_PAGE_MAX_RETRIES 100000 // Reader gives up (writer died mid-update)
+
+typedef struct {
+    int32_t id;                      // -1 = empty
+    int32_t type;
+    int64_t arrival_ns;              // CLOCK_MONOTONIC, comparable across processes
+} StateVehicle;
+
+typedef struct {
+    int32_t count;                   // Vehicles queued
+    int32_t emergencies;             // Of which emergency vehicles
+    int32_t head_count;              // Entries of head[] in use
+    int32_t flow;                    // FlowState, while the lane is green
+    int64_t flow_deadline_ns;
+    int64_t arrivals;                // Detector totals (0 without sensors)
+    int64_t departures;
+    StateVehicle crossing;           // In the junction
+    StateVehicle head[STATE_PAGE_WINDOW]; // Queue order
+} StateLane;
+
+typedef struct {
+    int64_t updated_ns;              // Controller clock of this snapshot
+    uint64_t updates;                // Snapshots published so far
+    int32_t phase;                   // PhaseState
+    uint32_t green_mask;
+    int32_t lead_lane;
+    int32_t emergency_round;
+    int64_t green_start_ns;
+    int64_t deadline_ns;             // Next phase step (INT64_MAX = none)
+    int64_t phases;
+    int64_t preemptions;
+    StateLane lanes[NUM_LANES];
+} StateSnapshot;
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t page_bytes;             // sizeof(StatePage) of the writer
+    int32_t writer_pid;
+    atomic_int live;                 // 0 once the controller has shut down
+    int64_t started_ns;
+    _Alignas(CACHE_LINE) atomic_uint seq; // Odd while `snapshot` is being written
+    StateSnapshot snapshot;
+} StatePage;
+
+// Controller side: creates (or replaces) the segment; NULL on failure
+StatePage* state_page_create(const char* name);
+void state_page_publish(StatePage* p, const Controller* c, int64_t now); // Controller thread only
+void state_page_destroy(StatePage* p, const char* name); // Marks it closed and unlinks it; readers keep their mapping
+
+// Reader side: read-only mapping; NULL if missing or not a state page of this layout
+const StatePage* state_page_attach(const char* name);
+// Consistent copy of the latest snapshot. Returns the retries it took, or
+// -1 if the writer stayed mid-update for STATE_PAGE_MAX_RETRIES attempts.
+int state_page_read(const StatePage* p, StateSnapshot* out);
+void state_page_detach(const StatePage* p);
+
+#endif
@@ -0,0 +1,333 @@
+#include "sweep.h"
+#include <errno.h>
+#include <unistd.h>
+
+#define SWEEP_AXES 5
+
+void sweep_default_config(SweepConfig* cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    sim_default_config(&cfg->base);
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    cfg->threads = cpus > 0 ? (int)cpus : 1;
+    cfg->out_path = "sweep.csv";
+}
+
+int sweep_parse_axis(SweepAxis* axis, const char* list) {
+    axis->count = 0;
+    const char* p = list;
+    for (;;) {
+        char* end;
+        errno = 0;
+        double v = strtod(p, &end);
+        if (end == p || errno != 0 || axis->count == SWEEP_MAX_VALUES) return -1;
+        axis->values[axis->count++] = v;
+        if (*end == '\0') return 0;
+        if (*end != ',') return -1;
+        p = end + 1;
+    }
+}
+
+int sweep_parse_seeds(SweepConfig* cfg, const char* range) {
+    char* end;
+    unsigned long long first = strtoull(range, &end, 10);
+    unsigned long long last = first;
+    if (end == range) return -1;
+    if (*end == '-') {
+        const char* p = end + 1;
+        last = strtoull(p, &end, 10);
+        if (end == p) return -1;
+    }
+    if (*end != '\0' || last < first) return -1;
+    cfg->seed_first = first;
+    cfg->seed_count = last - first + 1;
+    return 0;
+}
+
+// ---------------- Grid ----------------
+
+// The swept axes, with the base value standing in for any left empty.
+// Run t is seed (t % seeds) of combination (t / seeds); a combination is
+// a mixed-radix number over the axes, the last one varying fastest.
+typedef struct {
+    SweepAxis axis[SWEEP_AXES];
+    unsigned long long seed_first;
+    long seeds;
+    long combinations;
+    long runs;
+} SweepGrid;
+
+static const char* axis_names[SWEEP_AXES] = { "green_sec", "aging_threshold", "all_red_sec", "arrival_scale", "emergency_percent" };
+
+static void fill_axis(SweepAxis* out, const SweepAxis* in, double base) {
+    *out = *in;
+    if (out->count == 0) {
+        out->values[0] = base;
+        out->count = 1;
+    }
+}
+
+static int build_grid(const SweepConfig* cfg, SweepGrid* g) {
+    const SimConfig* b = &cfg->base;
+    fill_axis(&g->axis[0], &cfg->green_sec, b->green_sec > 0 ? b->green_sec : GREEN_DURATION_SEC);
+    fill_axis(&g->axis[1], &cfg->aging_threshold, b->aging_threshold > 0 ? b->aging_threshold : AGING_THRESHOLD);
+    fill_axis(&g->axis[2], &cfg->all_red_sec, b->all_red_sec > 0 ? b->all_red_sec : ALL_RED_USEC / 1e6);
+    fill_axis(&g->axis[3], &cfg->arrival_scale, b->arrival_scale);
+    fill_axis(&g->axis[4], &cfg->emergency_percent, b->emergency_percent);
+    for (int a = 0; a < SWEEP_AXES; a++) {
+        for (int i = 0; i < g->axis[a].count; i++) {
+            double v = g->axis[a].values[i];
+            int valid = a == 4 ? v >= 0 && v <= 100 && v == (int)v
+                      : a == 1 ? v >= 1 && v == (int)v
+                      : v > 0;
+            if (!valid) {
+                fprintf(stderr, "sweep: invalid %s %g\n", axis_names[a], v);
+                return -1;
+            }
+        }
+    }
+    g->seed_first = cfg->seed_count ? cfg->seed_first : b->seed;
+    g->seeds = cfg->seed_count ? (long)cfg->seed_count : 1;
+    g->combinations = 1;
+    for (int a = 0; a < SWEEP_AXES; a++) g->combinations *= g->axis[a].count;
+    g->runs = g->combinations * g->seeds;
+    return 0;
+}
+
+static void combination_values(const SweepGrid* g, long combo, double values[SWEEP_AXES]) {
+    for (int a = SWEEP_AXES - 1; a >= 0; a--) {
+        values[a] = g->axis[a].values[combo % g->axis[a].count];
+        combo /= g->axis[a].count;
+    }
+}
+
+static void run_config(const SweepConfig* cfg, const SweepGrid* g, long run, SimConfig* out) {
+    double v[SWEEP_AXES];
+    combination_values(g, run / g->seeds, v);
+    *out = cfg->base;
+    out->green_sec = v[0];
+    out->aging_threshold = (int)v[1];
+    out->all_red_sec = v[2];
+    out->arrival_scale = v[3];
+    out->emergency_percent = (int)v[4];
+    out->seed = g->seed_first + (unsigned long long)(run % g->seeds);
+    out->stats_path = out->record_path = out->journal_path = out->replay_path = NULL;
+}
+
+// ---------------- Work-Stealing Pool ----------------
+
+// Runs [next, end) belong to the worker. It takes from the front and
+// thieves split off the back, both under the worker's lock; a run is
+// seconds of simulation, so the lock is never contended for long.
+typedef struct {
+    _Alignas(CACHE_LINE) pthread_mutex_t lock;
+    long next;
+    long end;
+    long steals;
+    double cpu_sec;                   // Thread CPU time, once finished
+    int id;
+    struct SweepPool* pool;
+} SweepWorker;
+
+typedef struct SweepPool {
+    const SweepConfig* cfg;
+    const SweepGrid* grid;
+    SimSummary* results;              // By run index
+    SweepWorker* workers;
+    int threads;
+    atomic_long completed;
+    pthread_mutex_t done_lock;        // The last run signals `done`
+    pthread_cond_t done;
+} SweepPool;
+
+static long take_own(SweepWorker* w) {
+    pthread_mutex_lock(&w->lock);
+    long run = w->next < w->end ? w->next++ : -1;
+    pthread_mutex_unlock(&w->lock);
+    return run;
+}
+
+// Back half (rounded up) of the first non-empty range after ours; 0 if
+// every range is empty, which means all runs are taken
+static int steal(SweepWorker* w) {
+    SweepPool* pool = w->pool;
+    for (int k = 1; k < pool->threads; k++) {
+        SweepWorker* victim = &pool->workers[(w->id + k) % pool->threads];
+        pthread_mutex_lock(&victim->lock);
+        long left = victim->end - victim->next;
+        long from = victim->end - (left + 1) / 2;
+        long to = victim->end;
+        if (left > 0) victim->end = from;
+        pthread_mutex_unlock(&victim->lock);
+        if (left > 0) {
+            pthread_mutex_lock(&w->lock);
+            w->next = from;
+            w->end = to;
+            w->steals++;
+            pthread_mutex_unlock(&w->lock);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void* sweep_worker(void* arg) {
+    SweepWorker* w = arg;
+    SweepPool* pool = w->pool;
+    for (;;) {
+        long run = take_own(w);
+        if (run < 0) {
+            if (!steal(w)) break;
+            continue;
+        }
+        SimConfig run_cfg;
+        run_config(pool->cfg, pool->grid, run, &run_cfg);
+        sim_run_summary(&run_cfg, &pool->results[run]);
+        if (atomic_fetch_add(&pool->completed, 1) + 1 == pool->grid->runs) {
+            pthread_mutex_lock(&pool->done_lock);
+            pthread_cond_signal(&pool->done);
+            pthread_mutex_unlock(&pool->done_lock);
+        }
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    w->cpu_sec = ts.tv_sec + ts.tv_nsec / 1e9;
+    return NULL;
+}
+
+// ---------------- Output ----------------
+
+static int write_csv(const SweepConfig* cfg, const SweepGrid* g, const SimSummary* results) {
+    FILE* out = fopen(cfg->out_path, "w");
+    if (out == NULL) return -1;
+    for (int a = 0; a < SWEEP_AXES; a++) fprintf(out, "%s,", axis_names[a]);
+    fprintf(out, "seed,arrived,crossed,queued,max_queued,vehicles_per_hour,wait_mean_s,wait_p50_s,wait_p95_s,"
+                 "wait_p99_s,wait_max_s,emergencies,emergency_p50_s,emergency_p99_s,emergency_max_s,"
+                 "phases,preemptions,wall_s\n");
+    for (long run = 0; run < g->runs; run++) {
+        const SimSummary* r = &results[run];
+        double v[SWEEP_AXES];
+        combination_values(g, run / g->seeds, v);
+        for (int a = 0; a < SWEEP_AXES; a++) fprintf(out, "%g,", v[a]);
+        fprintf(out, "%llu,%lld,%lld,%lld,%lld,%.1f,%.3f,%.3f,%.3f,%.3f,%.3f,%lld,%.3f,%.3f,%.3f,%lld,%lld,%.4f\n",
+                g->seed_first + (unsigned long long)(run % g->seeds), r->arrived, r->crossed, r->queued,
+                r->max_queued, r->vehicles_per_hour, r->wait_mean_sec, r->wait_p50_sec, r->wait_p95_sec,
+                r->wait_p99_sec, r->wait_max_sec, r->emergencies, r->emergency_p50_sec, r->emergency_p99_sec,
+                r->emergency_max_sec, r->phases, r->preemptions, r->wall_sec);
+    }
+    return fclose(out) == 0 ? 0 : -1;
+}
+
+// Demand (arrival scale and mix) is an input, not something to tune, so the
+// best timing is reported per demand setting: lowest mean wait over seeds
+static void print_best(const SweepGrid* g, const SimSummary* results) {
+    int timings = g->axis[0].count * g->axis[1].count * g->axis[2].count;
+    int demands = g->axis[3].count * g->axis[4].count;
+    printf("  Best timing per demand (mean over %ld seeds):\n", g->seeds);
+    printf(" +-------+-------+---------+-------+---------+----------+-----------+-----------+------------+\n");
+    printf(" | SCALE | EMERG | GREEN   | AGING | ALL-RED | VEH/H    | MEAN WAIT | P99 WAIT  | EMERG P99  |\n");
+    printf(" +-------+-------+---------+-------+---------+----------+-----------+-----------+------------+\n");
+    for (int d = 0; d < demands; d++) {
+        long best = -1;
+        double best_wait = 0, best_vph = 0, best_p99 = 0, best_emerg = 0;
+        for (int t = 0; t < timings; t++) {
+            long combo = (long)t * demands + d;
+            double wait = 0, vph = 0, p99 = 0, emerg = 0;
+            for (long s = 0; s < g->seeds; s++) {
+                const SimSummary* r = &results[combo * g->seeds + s];
+                wait += r->wait_mean_sec;
+                vph += r->vehicles_per_hour;
+                p99 += r->wait_p99_sec;
+                emerg += r->emergency_p99_sec;
+            }
+            if (best < 0 || wait < best_wait) {
+                best = combo;
+                best_wait = wait;
+                best_vph = vph;
+                best_p99 = p99;
+                best_emerg = emerg;
+            }
+        }
+        double v[SWEEP_AXES];
+        combination_values(g, best, v);
+        printf(" | %-5g | %4g%% | %5g s | %-5g | %5g s | %-8.0f | %7.1f s | %7.1f s | %8.1f s |\n",
+               v[3], v[4], v[0], v[1], v[2], best_vph / g->seeds, best_wait / g->seeds,
+               best_p99 / g->seeds, best_emerg / g->seeds);
+    }
+    printf(" +-------+-------+---------+-------+---------+----------+-----------+-----------+------------+\n");
+}
+
+int run_parameter_sweep(const SweepConfig* cfg) {
+    SweepGrid g;
+    if (build_grid(cfg, &g) != 0) return -1;
+    if (cfg->base.duration_sec <= 0 || cfg->threads <= 0) {
+        fprintf(stderr, "sweep: duration and threads must be positive\n");
+        return -1;
+    }
+    int threads = cfg->threads < g.runs ? cfg->threads : (int)g.runs;
+    printf("Parameter sweep: %ld combinations x %ld seeds = %ld runs of %.2f h (%s scheduler), %d threads\n",
+           g.combinations, g.seeds, g.runs, cfg->base.duration_sec / 3600.0, cfg->base.scheduler->name, threads);
+    fflush(stdout);
+
+    SweepPool pool;
+    pool.cfg = cfg;
+    pool.grid = &g;
+    pool.results = calloc(g.runs, sizeof(SimSummary));
+    pool.workers = calloc(threads, sizeof(SweepWorker));
+    pool.threads = threads;
+    atomic_init(&pool.completed, 0);
+    pthread_mutex_init(&pool.done_lock, NULL);
+    pthread_cond_init(&pool.done, NULL);
+    // Contiguous equal shares to start with; stealing evens out the rest
+    for (int k = 0; k < threads; k++) {
+        SweepWorker* w = &pool.workers[k];
+        pthread_mutex_init(&w->lock, NULL);
+        w->next = g.runs * k / threads;
+        w->end = g.runs * (k + 1) / threads;
+        w->id = k;
+        w->pool = &pool;
+    }
+
+    pthread_t* tids = malloc(sizeof(pthread_t) * threads);
+    double start = wall_seconds();
+    for (int k = 0; k < threads; k++) pthread_create(&tids[k], NULL, sweep_worker, &pool.workers[k]);
+    // Progress once a second on a terminal, until the last run signals
+    int progress = isatty(STDERR_FILENO);
+    pthread_mutex_lock(&pool.done_lock);
+    while (atomic_load(&pool.completed) < g.runs) {
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_sec++;
+        pthread_cond_timedwait(&pool.done, &pool.done_lock, &until);
+        if (progress) fprintf(stderr, "\r  %ld/%ld runs", atomic_load(&pool.completed), g.runs);
+    }
+    pthread_mutex_unlock(&pool.done_lock);
+    for (int k = 0; k < threads; k++) pthread_join(tids[k], NULL);
+    double wall = wall_seconds() - start;
+    if (wall <= 0) wall = 1e-9;
+    if (progress) fprintf(stderr, "\r%*s\r", 32, "");
+
+    long steals = 0;
+    double cpu = 0;
+    for (int k = 0; k < threads; k++) {
+        steals += pool.workers[k].steals;
+        cpu += pool.workers[k].cpu_sec;
+        pthread_mutex_destroy(&pool.workers[k].lock);
+    }
+    pthread_mutex_destroy(&pool.done_lock);
+    pthread_cond_destroy(&pool.done);
+    printf("  Wall time : %.3f s (%.1f runs/s, %.2f cores busy), %ld steals\n", wall, g.runs / wall, cpu / wall, steals);
+
+    int rc = 0;
+    if (write_csv(cfg, &g, pool.results) != 0) {
+        perror("sweep: writing results failed");
+        rc = -1;
+    } else {
+        printf("  Results   : %s (one row per run)\n", cfg->out_path);
+    }
+    print_best(&g, pool.results);
+
+    free(tids);
+    free(pool.workers);
+    free(pool.results);
+    return rc;
+}
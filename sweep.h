@@ -0,0 +1,38 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "sim.h"
+
+// Parameter sweep
+// Every combination of the parameter lists below, each run once per seed.
+// Runs are independent headless simulations (sim_run_summary) on a pool of
+// worker threads. Each worker owns a contiguous range of runs and takes
+// from its front; once it is out, it steals the back half of another
+// worker's range, so slow runs (heavy demand, long greens) do not leave
+// threads idle at the end. One CSV row per run, in grid order.
+#define SWEEP_MAX_VALUES 32
+
+typedef struct {
+    double values[SWEEP_MAX_VALUES];
+    int count;                        // 0 = the base configuration's value
+} SweepAxis;
+
+typedef struct {
+    SimConfig base;                   // Everything not swept (duration, scheduler, phasing, ...)
+    SweepAxis green_sec;
+    SweepAxis aging_threshold;
+    SweepAxis all_red_sec;
+    SweepAxis arrival_scale;
+    SweepAxis emergency_percent;
+    unsigned long long seed_first;
+    unsigned long long seed_count;    // 0 = the base seed only
+    int threads;                      // Worker threads (default: online CPUs)
+    const char* out_path;             // CSV, one row per run
+} SweepConfig;
+
+void sweep_default_config(SweepConfig* cfg);
+int sweep_parse_axis(SweepAxis* axis, const char* list);    // "6,8,10"; -1 if malformed
+int sweep_parse_seeds(SweepConfig* cfg, const char* range); // "1-100" or "7"; -1 if malformed
+int run_parameter_sweep(const SweepConfig* cfg);
+
+#endif
@@ -0,0 +1,133 @@
+#include "timer_wheel.h"
+#include <string.h>
+
+#define SLOT_MASK (WHEEL_SLOTS - 1)
+
+void wheel_init(TimerWheel* w, int64_t now, int64_t tick_ns) {
+    memset(w, 0, sizeof(*w));
+    w->tick_ns = tick_ns > 0 ? tick_ns : 1;
+    w->cursor = now > 0 ? now / w->tick_ns : 0;
+}
+
+void wheel_timer_init(WheelTimer* t, int64_t data) {
+    memset(t, 0, sizeof(*t));
+    t->data = data;
+}
+
+static void link_timer(WheelTimer** head, WheelTimer* t) {
+    t->next = *head;
+    if (t->next) t->next->pprev = &t->next;
+    t->pprev = head;
+    *head = t;
+}
+
+// Files the timer on the level where its tick first differs from the
+// cursor's; a tick already passed goes in the cursor's own slot
+static void file_timer(TimerWheel* w, WheelTimer* t) {
+    int64_t tick = t->expires > 0 ? t->expires / w->tick_ns : 0;
+    if (tick < w->cursor) tick = w->cursor;
+    uint64_t diff = (uint64_t)(tick ^ w->cursor);
+    int level = diff ? (63 - __builtin_clzll(diff)) / WHEEL_BITS : 0;
+    if (level >= WHEEL_LEVELS) {
+        t->level = WHEEL_LEVELS;
+        link_timer(&w->overflow, t);
+        return;
+    }
+    int slot = (int)((tick >> (level * WHEEL_BITS)) & SLOT_MASK);
+    t->level = (uint8_t)level;
+    t->slot = (uint8_t)slot;
+    link_timer(&w->slots[level][slot], t);
+    w->occupied[level] |= 1ULL << slot;
+}
+
+static void unlink_timer(TimerWheel* w, WheelTimer* t) {
+    *t->pprev = t->next;
+    if (t->next) t->next->pprev = t->pprev;
+    t->next = NULL;
+    t->pprev = NULL;
+    if (t->level < WHEEL_LEVELS && w->slots[t->level][t->slot] == NULL) {
+        w->occupied[t->level] &= ~(1ULL << t->slot);
+    }
+}
+
+void wheel_schedule(TimerWheel* w, WheelTimer* t, int64_t expires, uint64_t key) {
+    if (t->pprev) unlink_timer(w, t);
+    else w->armed++;
+    t->expires = expires;
+    t->key = key;
+    file_timer(w, t);
+}
+
+void wheel_cancel(TimerWheel* w, WheelTimer* t) {
+    if (t->pprev == NULL) return;
+    unlink_timer(w, t);
+    w->armed--;
+}
+
+// Re-files a whole list against the (moved) cursor
+static void refile(TimerWheel* w, WheelTimer* list) {
+    while (list) {
+        WheelTimer* next = list->next;
+        file_timer(w, list);
+        list = next;
+    }
+}
+
+static WheelTimer* take_list(TimerWheel* w, WheelTimer** head) {
+    WheelTimer* list = *head;
+    *head = NULL;
+    return list;
+}
+
+static WheelTimer* earliest_of(WheelTimer* t) {
+    WheelTimer* best = t;
+    for (t = t->next; t; t = t->next) {
+        if (t->expires < best->expires || (t->expires == best->expires && t->key < best->key)) best = t;
+    }
+    return best;
+}
+
+WheelTimer* wheel_peek(TimerWheel* w) {
+    if (w->armed == 0) return NULL;
+    for (;;) {
+        // Level 0 holds exact ticks of the current rotation
+        uint64_t here = w->occupied[0] & (~0ULL << (w->cursor & SLOT_MASK));
+        if (here) {
+            int slot = __builtin_ctzll(here);
+            w->cursor = (w->cursor & ~(int64_t)SLOT_MASK) | slot;
+            return earliest_of(w->slots[0][slot]);
+        }
+
+        // Otherwise the next occupied slot on the lowest level that has one:
+        // move the cursor to its start and spread it over the levels below
+        int level;
+        for (level = 1; level < WHEEL_LEVELS; level++) {
+            int shift = level * WHEEL_BITS;
+            int index = (int)((w->cursor >> shift) & SLOT_MASK);
+            uint64_t ahead = index == SLOT_MASK ? 0 : w->occupied[level] & (~0ULL << (index + 1));
+            if (ahead == 0) continue;
+            int slot = __builtin_ctzll(ahead);
+            w->cursor = ((w->cursor >> (shift + WHEEL_BITS)) << (shift + WHEEL_BITS)) | ((int64_t)slot << shift);
+            w->occupied[level] &= ~(1ULL << slot);
+            refile(w, take_list(w, &w->slots[level][slot]));
+            break;
+        }
+        if (level < WHEEL_LEVELS) continue;
+
+        // Only far-future timers left: jump to the first and re-file them all
+        WheelTimer* first = earliest_of(w->overflow);
+        w->cursor = first->expires / w->tick_ns;
+        refile(w, take_list(w, &w->overflow));
+    }
+}
+
+WheelTimer* wheel_pop(TimerWheel* w) {
+    WheelTimer* t = wheel_peek(w);
+    if (t) wheel_cancel(w, t);
+    return t;
+}
+
+int64_t wheel_next_expiry(TimerWheel* w) {
+    WheelTimer* t = wheel_peek(w);
+    return t ? t->expires : INT64_MAX;
+}
@@ -0,0 +1,50 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+
+// Hierarchical timing wheel
+// WHEEL_LEVELS levels of WHEEL_SLOTS slots; a slot on level k spans
+// WHEEL_SLOTS^k ticks. A timer goes on the lowest level whose current
+// rotation still holds its tick, so arming, re-arming and cancelling are
+// O(1): an intrusive list splice and one bitmap bit. Finding the earliest
+// timer walks the occupancy bitmaps and only cascades the one higher-level
+// slot it lands on. Times are nanoseconds on any clock (virtual or
+// monotonic), and timers sharing a tick are ordered by (expires, key), so
+// the tick sets bucket width, not precision.
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 5 // 64^5 ticks ahead (12 days at 1 ms); later timers wait on an overflow list
+
+typedef struct WheelTimer {
+    struct WheelTimer* next;
+    struct WheelTimer** pprev; // NULL when not armed
+    int64_t expires;
+    uint64_t key;              // Tie-breaker between equal expiries: lower first
+    int64_t data;              // For the owner
+    uint8_t level;             // Where it is filed (WHEEL_LEVELS = overflow)
+    uint8_t slot;
+} WheelTimer;
+
+typedef struct {
+    int64_t tick_ns;
+    int64_t cursor;            // Current tick: no armed timer is filed before it
+    uint64_t occupied[WHEEL_LEVELS];
+    WheelTimer* slots[WHEEL_LEVELS][WHEEL_SLOTS];
+    WheelTimer* overflow;
+    int armed;
+} TimerWheel;
+
+void wheel_init(TimerWheel* w, int64_t now, int64_t tick_ns);
+void wheel_timer_init(WheelTimer* t, int64_t data);
+void wheel_schedule(TimerWheel* w, WheelTimer* t, int64_t expires, uint64_t key); // Arms, or moves if armed
+void wheel_cancel(TimerWheel* w, WheelTimer* t); // No-op when not armed
+static inline int wheel_timer_armed(const WheelTimer* t) { return t->pprev != 0; }
+
+// Earliest armed timer (NULL if none). Moves the cursor up to it, which is
+// safe: anything armed later at an earlier time files into the cursor slot.
+WheelTimer* wheel_peek(TimerWheel* w);
+WheelTimer* wheel_pop(TimerWheel* w);      // Same, disarmed
+int64_t wheel_next_expiry(TimerWheel* w);  // INT64_MAX if none
+
+#endif
@@ -0,0 +1,203 @@
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define TRACE_WRITE_BUFFER (1 << 20)
+#define TRACE_RELEASE_RECORDS (1 << 20) // Drop replayed pages every ~12 MB
+
+// ---------------- Recording ----------------
+
+int trace_writer_open(TraceWriter* w, const char* path, int64_t start_ns, time_t start_wall) {
+    memset(w, 0, sizeof(*w));
+    w->out = fopen(path, "wb");
+    if (w->out == NULL) return -1;
+    setvbuf(w->out, NULL, _IOFBF, TRACE_WRITE_BUFFER);
+
+    w->header.magic = TRACE_MAGIC;
+    w->header.version = TRACE_VERSION;
+    w->header.record_size = sizeof(TraceRecord);
+    w->header.start_ns = start_ns;
+    w->header.start_wall = (int64_t)start_wall;
+    w->header.index_stride = TRACE_INDEX_STRIDE;
+    // Rewritten on close; until then readers size the trace from the file
+    if (fwrite(&w->header, sizeof(w->header), 1, w->out) != 1) {
+        fclose(w->out);
+        w->out = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static int put_record(TraceWriter* w, const TraceRecord* rec) {
+    w->last_offset_ns += (int64_t)rec->delta_us * 1000;
+    if (w->header.record_count % TRACE_INDEX_STRIDE == 0) {
+        if (w->header.index_count == w->index_capacity) {
+            size_t capacity = w->index_capacity ? w->index_capacity * 2 : 64;
+            TraceIndexEntry* grown = realloc(w->index, capacity * sizeof(TraceIndexEntry));
+            if (grown == NULL) return -1;
+            w->index = grown;
+            w->index_capacity = capacity;
+        }
+        TraceIndexEntry* e = &w->index[w->header.index_count++];
+        e->record = w->header.record_count;
+        e->offset_ns = w->last_offset_ns;
+    }
+    w->header.record_count++;
+    return fwrite(rec, sizeof(*rec), 1, w->out) == 1 ? 0 : -1;
+}
+
+// Deltas are kept in whole microseconds; the writer tracks the quantized
+// sum so a replay lands on exactly the offsets the index records
+int trace_write(TraceWriter* w, int64_t now_ns, int id, int lane, int type) {
+    int64_t offset = now_ns - w->header.start_ns;
+    if (offset < w->last_offset_ns) offset = w->last_offset_ns; // Producers' stamps may interleave
+    int64_t delta_us = (offset - w->last_offset_ns) / 1000;
+
+    TraceRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    while (delta_us > UINT32_MAX) {
+        rec.delta_us = UINT32_MAX;
+        rec.type = TRACE_GAP_TYPE;
+        if (put_record(w, &rec) != 0) return -1;
+        delta_us -= UINT32_MAX;
+    }
+    rec.delta_us = (uint32_t)delta_us;
+    rec.id = id;
+    rec.lane = (uint8_t)lane;
+    rec.type = (uint8_t)type;
+    if (put_record(w, &rec) != 0) return -1;
+    w->header.vehicle_count++;
+    w->header.end_offset_ns = w->last_offset_ns;
+    return 0;
+}
+
+int trace_writer_close(TraceWriter* w) {
+    if (w->out == NULL) return -1;
+    int rc = 0;
+    long index_offset = ftell(w->out);
+    if (index_offset < 0 ||
+        fwrite(w->index, sizeof(TraceIndexEntry), w->header.index_count, w->out) != w->header.index_count) {
+        rc = -1;
+    } else {
+        w->header.index_offset = (uint64_t)index_offset;
+        if (fseek(w->out, 0, SEEK_SET) != 0 || fwrite(&w->header, sizeof(w->header), 1, w->out) != 1) rc = -1;
+    }
+    if (fclose(w->out) != 0) rc = -1;
+    free(w->index);
+    w->out = NULL;
+    w->index = NULL;
+    return rc;
+}
+
+// ---------------- Replay ----------------
+
+int trace_reader_open(TraceReader* r, const char* path) {
+    memset(r, 0, sizeof(*r));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TraceHeader)) {
+        close(fd);
+        return -1;
+    }
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+    r->map = map;
+    r->map_bytes = (size_t)st.st_size;
+    madvise(map, r->map_bytes, MADV_SEQUENTIAL);
+
+    memcpy(&r->header, r->map, sizeof(TraceHeader));
+    TraceHeader* h = &r->header;
+    size_t body = r->map_bytes - sizeof(TraceHeader);
+    if (h->magic != TRACE_MAGIC || h->version != TRACE_VERSION || h->record_size != sizeof(TraceRecord)) {
+        trace_reader_close(r);
+        return -1;
+    }
+    r->records = (const TraceRecord*)(r->map + sizeof(TraceHeader));
+
+    if (h->index_offset == 0) {
+        // Recording never closed (crash, kill -9): keep every whole record
+        // and recover the totals with one pass over the deltas
+        h->record_count = body / sizeof(TraceRecord);
+        h->vehicle_count = 0;
+        int64_t offset = 0;
+        for (uint64_t i = 0; i < h->record_count; i++) {
+            offset += (int64_t)r->records[i].delta_us * 1000;
+            if (r->records[i].type != TRACE_GAP_TYPE) h->vehicle_count++;
+        }
+        h->end_offset_ns = offset;
+        h->index_count = 0;
+    } else {
+        uint64_t records_end = sizeof(TraceHeader) + h->record_count * sizeof(TraceRecord);
+        uint64_t index_end = h->index_offset + (uint64_t)h->index_count * sizeof(TraceIndexEntry);
+        if (records_end > h->index_offset || index_end > r->map_bytes || h->index_stride == 0) {
+            trace_reader_close(r);
+            return -1;
+        }
+        r->index = (const TraceIndexEntry*)(r->map + h->index_offset);
+    }
+    return 0;
+}
+
+// Replayed pages are clean file pages: hand them back so resident memory
+// stays flat however long the trace is
+static void release_replayed(TraceReader* r) {
+    long page = sysconf(_SC_PAGESIZE);
+    uintptr_t from = (uintptr_t)(r->records + r->released);
+    uintptr_t to = (uintptr_t)(r->records + r->next);
+    from = (from + page - 1) & ~(uintptr_t)(page - 1);
+    to &= ~(uintptr_t)(page - 1);
+    if (to > from) madvise((void*)from, to - from, MADV_DONTNEED);
+    r->released = r->next;
+}
+
+int trace_next(TraceReader* r, TraceArrival* out) {
+    while (r->next < r->header.record_count) {
+        const TraceRecord* rec = &r->records[r->next++];
+        r->offset_ns += (int64_t)rec->delta_us * 1000;
+        if (r->next - r->released >= TRACE_RELEASE_RECORDS) release_replayed(r);
+        if (rec->type == TRACE_GAP_TYPE) continue;
+        out->offset_ns = r->offset_ns;
+        out->id = rec->id;
+        out->lane = rec->lane;
+        out->type = rec->type;
+        return 0;
+    }
+    return 1;
+}
+
+// Binary search the index for the last entry at or before the target, then
+// walk forward at most one stride
+void trace_seek(TraceReader* r, int64_t offset_ns) {
+    r->next = 0;
+    r->offset_ns = 0;
+    if (r->index && r->header.index_count > 0) {
+        uint32_t lo = 0, hi = r->header.index_count;
+        while (hi - lo > 1) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (r->index[mid].offset_ns <= offset_ns) lo = mid;
+            else hi = mid;
+        }
+        const TraceIndexEntry* e = &r->index[lo];
+        if (e->offset_ns <= offset_ns && e->record < r->header.record_count) {
+            r->next = e->record;
+            r->offset_ns = e->offset_ns - (int64_t)r->records[e->record].delta_us * 1000;
+        }
+    }
+    while (r->next < r->header.record_count &&
+           r->offset_ns + (int64_t)r->records[r->next].delta_us * 1000 < offset_ns) {
+        r->offset_ns += (int64_t)r->records[r->next].delta_us * 1000;
+        r->next++;
+    }
+    r->released = r->next;
+}
+
+void trace_reader_close(TraceReader* r) {
+    if (r->map) munmap((void*)r->map, r->map_bytes);
+    memset(r, 0, sizeof(*r));
+}
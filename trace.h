@@ -0,0 +1,83 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+// Binary arrival trace
+// A fixed header, then one fixed-width record per arrival with the time
+// delta since the previous record, then a sparse index of absolute
+// offsets every TRACE_INDEX_STRIDE records for seeking. Files are replayed
+// straight from a read-only mapping: no parsing, and pages already
+// replayed are dropped, so a trace of tens of millions of vehicles needs
+// only a few MB of RAM.
+#define TRACE_MAGIC 0x3145434152545254ULL // "TRTRACE1"
+#define TRACE_VERSION 1
+#define TRACE_INDEX_STRIDE 65536
+#define TRACE_GAP_TYPE 0xFF // Record that only carries time (delta overflow)
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t record_count;  // Records, gap records included
+    uint64_t vehicle_count;
+    int64_t start_ns;       // Recording clock at offset 0
+    int64_t end_offset_ns;  // Offset of the last record
+    int64_t start_wall;     // time(NULL) at offset 0
+    uint64_t index_offset;  // Byte offset of the index (0 = recording not closed)
+    uint32_t index_stride;
+    uint32_t index_count;
+} TraceHeader;
+
+typedef struct {
+    uint32_t delta_us;  // Since the previous record (the first: since offset 0)
+    int32_t id;
+    uint8_t lane;
+    uint8_t type;       // Vehicle type or TRACE_GAP_TYPE
+    uint16_t reserved;
+} TraceRecord;
+
+typedef struct {
+    uint64_t record;    // Record number ...
+    int64_t offset_ns;  // ... and the offset it starts at
+} TraceIndexEntry;
+
+// One arrival as read back
+typedef struct {
+    int64_t offset_ns;  // Since the trace start
+    int id;
+    int lane;
+    int type;
+} TraceArrival;
+
+typedef struct {
+    FILE* out;
+    TraceHeader header;
+    int64_t last_offset_ns;
+    TraceIndexEntry* index;
+    size_t index_capacity;
+} TraceWriter;
+
+typedef struct {
+    const unsigned char* map;
+    size_t map_bytes;
+    TraceHeader header;
+    const TraceRecord* records;
+    const TraceIndexEntry* index; // NULL for an unclosed recording
+    uint64_t next;                // Cursor
+    int64_t offset_ns;            // Offset of the record before the cursor
+    uint64_t released;            // Records already handed back to the kernel
+} TraceReader;
+
+int trace_writer_open(TraceWriter* w, const char* path, int64_t start_ns, time_t start_wall);
+int trace_write(TraceWriter* w, int64_t now_ns, int id, int lane, int type); // Same clock as start_ns
+int trace_writer_close(TraceWriter* w); // Writes the index and final header
+
+int trace_reader_open(TraceReader* r, const char* path);
+int trace_next(TraceReader* r, TraceArrival* out); // 0 = ok, 1 = end of trace
+void trace_seek(TraceReader* r, int64_t offset_ns); // First arrival at or after offset_ns
+void trace_reader_close(TraceReader* r);
+
+#endif
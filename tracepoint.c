@@ -0,0 +1,215 @@
+#include "tracepoint.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include "utils.h"
+
+#ifdef TRACEPOINTS
+
+_Thread_local TpBuffer* tp_current;
+
+// Buffers move between their thread (held), the full list and the free
+// list under `lock`; a thread takes it once per TP_BUFFER_EVENTS points.
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    int enabled;
+    int stopping;
+    TpBuffer* full;               // Oldest first
+    TpBuffer* full_tail;
+    TpBuffer* free;
+    TpBuffer* all;
+    int buffers;
+    long long dropped;
+    long long written;
+    int fd;                       // Not a FILE: forked children would flush its buffer again
+    int failed;
+    char out[64 * 1024];          // Writer thread (then tp_close) only
+    size_t out_len;
+    pthread_t writer;
+    int pid;
+    uint64_t base_clock;          // tp_clock() and monotonic_ns() at tp_open
+    int64_t base_ns;
+} tp = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, .fd = -1 };
+
+static void flush_out(void) {
+    size_t done = 0;
+    while (done < tp.out_len) {
+        ssize_t n = write(tp.fd, tp.out + done, tp.out_len - done);
+        if (n <= 0) {
+            tp.failed = 1;
+            break;
+        }
+        done += n;
+    }
+    tp.out_len = 0;
+}
+
+// One JSON record (well under 256 bytes: names are short literals)
+static void emit(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+static void emit(const char* fmt, ...) {
+    if (sizeof(tp.out) - tp.out_len < 256) flush_out();
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(tp.out + tp.out_len, sizeof(tp.out) - tp.out_len, fmt, ap);
+    va_end(ap);
+    size_t room = sizeof(tp.out) - tp.out_len - 1;
+    if (n > 0) tp.out_len += (size_t)n < room ? (size_t)n : room;
+}
+
+TpBuffer* tp_next_buffer(void) {
+    TpBuffer* old = tp_current;
+    pthread_mutex_lock(&tp.lock);
+    if (!tp.enabled) {
+        pthread_mutex_unlock(&tp.lock);
+        return NULL;
+    }
+    TpBuffer* b = tp.free;
+    if (b) {
+        tp.free = b->next;
+    } else if (tp.buffers < TP_MAX_BUFFERS && (b = calloc(1, sizeof(TpBuffer))) != NULL) {
+        b->all = tp.all;
+        tp.all = b;
+        tp.buffers++;
+    }
+    if (b == NULL) {
+        // Writer far behind: lose this thread's buffer rather than wait
+        if (old) {
+            tp.dropped += atomic_load_explicit(&old->count, memory_order_relaxed);
+            atomic_store_explicit(&old->count, 0, memory_order_relaxed);
+        }
+        pthread_mutex_unlock(&tp.lock);
+        return old;
+    }
+    b->tid = old ? old->tid : (int)syscall(SYS_gettid);
+    b->next = NULL;
+    if (old) {
+        old->next = NULL;
+        if (tp.full_tail) tp.full_tail->next = old;
+        else tp.full = old;
+        tp.full_tail = old;
+        pthread_cond_signal(&tp.wake);
+    }
+    tp_current = b;
+    pthread_mutex_unlock(&tp.lock);
+    return b;
+}
+
+// TSC stamps are mapped onto the monotonic clock by the rate measured from
+// tp_open to now, which only gets more exact as the run goes on
+static void write_events(TpBuffer* b, int count) {
+    uint64_t clock_now = tp_clock();
+    int64_t ns_now = monotonic_ns();
+    double ns_per_tick = clock_now > tp.base_clock ? (double)(ns_now - tp.base_ns) / (clock_now - tp.base_clock) : 1.0;
+    for (int i = 0; i < count; i++) {
+        const TpEvent* e = &b->events[i];
+        const char* sep = tp.written++ ? ",\n" : "";
+        if (e->phase == 'M') {
+            emit("%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                 sep, tp.pid, b->tid, e->name);
+            continue;
+        }
+        double us = ((double)e->ts - (double)tp.base_clock) * ns_per_tick / 1e3;
+        emit("%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d}",
+             sep, e->name, e->phase, us, tp.pid, b->tid);
+    }
+}
+
+static void* tp_writer(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&tp.lock);
+    for (;;) {
+        while (tp.full == NULL && !tp.stopping) pthread_cond_wait(&tp.wake, &tp.lock);
+        TpBuffer* b = tp.full;
+        if (b == NULL) break;
+        tp.full = b->next;
+        if (tp.full == NULL) tp.full_tail = NULL;
+        pthread_mutex_unlock(&tp.lock);
+
+        write_events(b, atomic_load_explicit(&b->count, memory_order_acquire));
+        flush_out();
+
+        pthread_mutex_lock(&tp.lock);
+        atomic_store_explicit(&b->count, 0, memory_order_relaxed);
+        b->next = tp.free;
+        tp.free = b;
+    }
+    pthread_mutex_unlock(&tp.lock);
+    return NULL;
+}
+
+int tp_open(const char* path) {
+    tp.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (tp.fd == -1) return -1;
+    tp.failed = 0;
+    emit("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    flush_out();
+    tp.pid = (int)getpid();
+    tp.base_clock = tp_clock();
+    tp.base_ns = monotonic_ns();
+    tp.stopping = 0;
+    if (pthread_create(&tp.writer, NULL, tp_writer, NULL) != 0) {
+        close(tp.fd);
+        tp.fd = -1;
+        return -1;
+    }
+    pthread_mutex_lock(&tp.lock);
+    tp.enabled = 1;
+    pthread_mutex_unlock(&tp.lock);
+    return 0;
+}
+
+// Buffers still held by a thread are written up to the count it last
+// published. They stay allocated: their threads may still be running.
+int tp_close(void) {
+    if (tp.fd == -1) return 0;
+    pthread_mutex_lock(&tp.lock);
+    tp.enabled = 0;
+    tp.stopping = 1;
+    pthread_cond_signal(&tp.wake);
+    pthread_mutex_unlock(&tp.lock);
+    pthread_join(tp.writer, NULL);
+
+    // Free buffers were emptied by the writer, so only held ones have events
+    for (TpBuffer* b = tp.all; b; b = b->all) {
+        int n = atomic_load_explicit(&b->count, memory_order_acquire);
+        if (n > 0) write_events(b, n);
+    }
+    emit("\n]}\n");
+    flush_out();
+    if (close(tp.fd) != 0) tp.failed = 1;
+    tp.fd = -1;
+    return tp.failed ? -1 : 0;
+}
+
+long long tp_dropped(void) {
+    return tp.dropped;
+}
+
+long long tp_written(void) {
+    return tp.written;
+}
+
+#else
+
+int tp_open(const char* path) {
+    (void)path;
+    return -1;
+}
+
+int tp_close(void) {
+    return 0;
+}
+
+long long tp_dropped(void) {
+    return 0;
+}
+
+long long tp_written(void) {
+    return 0;
+}
+
+#endif
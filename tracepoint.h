@@ -0,0 +1,98 @@
+#ifndef TRACEPOINT_H
+#define TRACEPOINT_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Trace points
+// TP_BEGIN/TP_END mark a span on the calling thread; TP_LOCK/TP_UNLOCK
+// take a mutex and record both the wait for it and the time it was held.
+// Names must be string literals. Built with TRACEPOINTS defined
+// (make TRACEPOINTS=1), a point stores a TSC stamp and the name's address
+// into the thread's own buffer: no lock, no syscall, no formatting. Full
+// buffers go to a writer thread that converts them to Chrome trace-event
+// JSON (chrome://tracing, ui.perfetto.dev). Without TRACEPOINTS the spans
+// compile to nothing and the lock macros to the bare pthread calls.
+#define TP_BUFFER_EVENTS 4096 // Per buffer (96 KB)
+#define TP_MAX_BUFFERS 256    // Past this, a full buffer is discarded instead of queued
+
+#ifdef TRACEPOINTS
+
+typedef struct {
+    uint64_t ts;                  // tp_clock()
+    const char* name;
+    char phase;                   // 'B', 'E', or 'M' (thread name)
+} TpEvent;
+
+typedef struct TpBuffer {
+    TpEvent events[TP_BUFFER_EVENTS];
+    atomic_int count;             // Owner stores with release; the writer may read a held buffer at close
+    int tid;
+    struct TpBuffer* next;        // Full or free list
+    struct TpBuffer* all;         // Every buffer, for the final flush
+} TpBuffer;
+
+extern _Thread_local TpBuffer* tp_current;
+TpBuffer* tp_next_buffer(void);   // Hands in the full one; NULL while tracing is off
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t tp_clock(void) { return __rdtsc(); }
+#else
+#include "utils.h"
+static inline uint64_t tp_clock(void) { return (uint64_t)monotonic_ns(); }
+#endif
+
+static inline void tp_record(const char* name, char phase) {
+    TpBuffer* b = tp_current;
+    if (b == NULL || atomic_load_explicit(&b->count, memory_order_relaxed) == TP_BUFFER_EVENTS) {
+        b = tp_next_buffer();
+        if (b == NULL) return;
+    }
+    int n = atomic_load_explicit(&b->count, memory_order_relaxed);
+    b->events[n].ts = tp_clock();
+    b->events[n].name = name;
+    b->events[n].phase = phase;
+    atomic_store_explicit(&b->count, n + 1, memory_order_release);
+}
+
+static inline int tp_lock(pthread_mutex_t* m, const char* held, const char* wait) {
+    tp_record(wait, 'B');
+    int rc = pthread_mutex_lock(m);
+    tp_record(wait, 'E');
+    tp_record(held, 'B');
+    return rc;
+}
+
+static inline int tp_unlock(pthread_mutex_t* m, const char* held) {
+    tp_record(held, 'E');
+    return pthread_mutex_unlock(m);
+}
+
+#define TP_BEGIN(name) tp_record(name, 'B')
+#define TP_END(name) tp_record(name, 'E')
+#define TP_THREAD(name) tp_record(name, 'M')
+#define TP_LOCK(mutex, name) tp_lock(mutex, name, name " (wait)")
+#define TP_UNLOCK(mutex, name) tp_unlock(mutex, name)
+
+#else
+
+#define TP_BEGIN(name) ((void)0)
+#define TP_END(name) ((void)0)
+#define TP_THREAD(name) ((void)0)
+#define TP_LOCK(mutex, name) pthread_mutex_lock(mutex)
+#define TP_UNLOCK(mutex, name) pthread_mutex_unlock(mutex)
+
+#endif
+
+// Starts recording to `path`: 0 = ok, -1 if it cannot be created or the
+// build has no trace points
+int tp_open(const char* path);
+// Stops recording, writes out every buffer and closes the JSON: 0 = ok,
+// -1 if a write failed. Threads still running afterwards record nothing more.
+int tp_close(void);
+long long tp_written(void);       // Events in the JSON so far
+long long tp_dropped(void);       // Events lost to TP_MAX_BUFFERS
+
+#endif
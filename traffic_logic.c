@@ -1,120 +1,213 @@
 #include "traffic_logic.h"
-#include <unistd.h>
 #include <stdio.h>
+#include <string.h>
 
-Node* lane_queues[NUM_LANES] = {NULL, NULL, NULL, NULL};
-pthread_mutex_t intersection_mutex;
-pthread_mutex_t queue_mutex;
-int current_green_lane = -1;
+LaneQueue lane_queues[NUM_LANES];
+LaneIntake lane_intakes[NUM_LANES];
+LaneSensor lane_sensors[NUM_LANES];
 
 void init_traffic_system() {
-    pthread_mutex_init(&intersection_mutex, NULL);
-    pthread_mutex_init(&queue_mutex, NULL);
+    int64_t now = monotonic_ns();
+    for (int i = 0; i < NUM_LANES; i++) {
+        lane_intake_init(&lane_intakes[i], LANE_INTAKE_CAPACITY);
+        sensor_init(&lane_sensors[i], now);
+    }
+}
+
+// Any thread: queue a vehicle for its lane's owner to collect. Lock-free.
+// SUBMIT_FULL means the owner has to drain the intake first; SUBMIT_INVALID
+// (no such lane or type) will not succeed however often it is retried.
+int submit_vehicle(const Vehicle* v) {
+    if (v->lane < 0 || v->lane >= NUM_LANES || v->type < 0 || v->type >= NUM_VEHICLE_TYPES) return SUBMIT_INVALID;
+    if (lane_intake_push(&lane_intakes[v->lane], v) != 0) return SUBMIT_FULL;
+    sensor_count_arrival(&lane_sensors[v->lane]);
+    return SUBMIT_OK;
 }
 
+// One per lane: turns the lane's detector counts into smoothed arrival and
+// discharge rates, queue length and trend (see sensor.h). It never touches
+// the lane queue itself, which belongs to the controller thread.
 void* sensor_thread(void* arg) {
-    (void)arg; // Silence unused warning
+    SensorArgs* args = (SensorArgs*)arg;
+    LaneSensor* sensor = &lane_sensors[args->lane_id];
+    // Samples on a fixed absolute grid, so the period does not stretch by
+    // each pass's run time
+    int64_t next = monotonic_ns();
     while (1) {
-        pthread_mutex_lock(&queue_mutex);
-        // Monitor implementation
-        // int count = count_vehicles(lane_queues[args->lane_id]);
-        
-        // Simple logic: if count is extremely high w/o emergency, maybe flag it? 
-        // For now, this thread just "monitors" - in a real HW system it would populate the list.
-        // Here we just use it to maybe print "Sensor [North]: Density High" if needed.
-        // But main loop does printing, so we keep this minimal.
-        
-        pthread_mutex_unlock(&queue_mutex);
-        
-        sleep(2); // Monitor every 2 seconds
+        next += SENSOR_PERIOD_USEC * 1000LL;
+        while (sleep_until_ns(next) != 0) { /* EINTR */ }
+        sensor_sample(sensor, next);
     }
     return NULL;
 }
 
 // Aging Algorithm: Increment priority of waiting cars
-#define AGING_THRESHOLD 10
+// Lazy: one epoch tick per lane; each car's score is derived on demand
+// from the epochs elapsed since it was queued (see LaneQueue). The lane
+// may reach CLASS_AGED (AGING_THRESHOLD), so its summary and index entry
+// are refreshed.
+void handle_aging(LaneQueue* q) {
+    age_lane(q, 1);
+}
 
-void handle_aging(Node** head) {
-    Node* temp = *head;
-    while (temp != NULL) {
-        if (temp->vehicle.type == REGULAR_CAR) {
-             temp->vehicle.priority_score++;
-        }
-        temp = temp->next;
-    }
+void handle_aging_by(LaneQueue* q, int passes) {
+    age_lane(q, passes);
 }
 
 // Helper: Check if specific lane has emergency
 int has_emergency(int lane_id) {
+    return has_emergency_in(lane_queues, lane_id);
+}
+
+int has_emergency_in(LaneQueue lanes[], int lane_id) {
     if (lane_id < 0 || lane_id >= NUM_LANES) return 0;
-    Node* temp = lane_queues[lane_id];
-    while(temp != NULL) {
-        // Emergency if not regular car OR priority score is high
-        if(temp->vehicle.type != REGULAR_CAR || temp->vehicle.priority_score >= AGING_THRESHOLD) return 1;
-        temp = temp->next;
-    }
-    return 0;
+    // Emergency if not regular car OR priority score is high.
+    // The oldest regular car has waited through the most aging passes.
+    return lane_top_class(&lanes[lane_id]) <= CLASS_AGED;
 }
 
 // Global Emergency Check
 int is_any_emergency_active() {
+    return is_any_emergency_active_in(lane_queues);
+}
+
+int is_any_emergency_active_in(LaneQueue lanes[]) {
     for(int i=0; i<NUM_LANES; i++) {
-        if (has_emergency(i)) return 1;
+        if (has_emergency_in(lanes, i)) return 1;
     }
     return 0;
 }
 
 int select_next_lane(int current_lane) {
-    // 1. Priority Loop: Check for Emergency (Round Robin starting next to current)
+    return select_next_lane_in(lane_queues, current_lane);
+}
+
+// Same rules for any intersection's lanes, without a priority index:
+// the lane with the most urgent class (fire > ambulance > police > aged
+// car > car), Round Robin from the one after current among equals
+int select_next_lane_in(LaneQueue lanes[], int current_lane) {
+    int best = -1;
+    int best_class = CLASS_NONE;
     for (int i = 1; i <= NUM_LANES; i++) {
         int idx = (current_lane + i) % NUM_LANES;
-        if (has_emergency(idx)) return idx;
+        int cls = lane_top_class(&lanes[idx]);
+        if (cls < best_class) {
+            best = idx;
+            best_class = cls;
+        }
+    }
+    return best; // -1: all empty
+}
+
+const LaneMask conflicts_through[NUM_LANES] = {
+    [NORTH] = LANE_BIT(EAST) | LANE_BIT(WEST),
+    [SOUTH] = LANE_BIT(EAST) | LANE_BIT(WEST),
+    [EAST] = LANE_BIT(NORTH) | LANE_BIT(SOUTH),
+    [WEST] = LANE_BIT(NORTH) | LANE_BIT(SOUTH),
+};
+
+const LaneMask conflicts_exclusive[NUM_LANES] = {
+    [NORTH] = LANE_BIT(SOUTH) | LANE_BIT(EAST) | LANE_BIT(WEST),
+    [SOUTH] = LANE_BIT(NORTH) | LANE_BIT(EAST) | LANE_BIT(WEST),
+    [EAST] = LANE_BIT(NORTH) | LANE_BIT(SOUTH) | LANE_BIT(WEST),
+    [WEST] = LANE_BIT(NORTH) | LANE_BIT(SOUTH) | LANE_BIT(EAST),
+};
+
+// Greedy in lane order; a few ANDs per added approach
+LaneMask compatible_phase(const LaneMask conflicts[], int lead, LaneMask candidates) {
+    LaneMask phase = LANE_BIT(lead);
+    LaneMask open = candidates & ~conflicts[lead] & ~phase;
+    while (open) {
+        int lane = __builtin_ctz(open);
+        phase |= LANE_BIT(lane);
+        open &= ~conflicts[lane] & ~LANE_BIT(lane);
+    }
+    return phase;
+}
+
+// Emergency lanes under the policy's rules (aged cars included or not)
+int has_emergency_with(const SchedulerPolicy* policy, LaneQueue lanes[], int lane_id) {
+    if (lane_id < 0 || lane_id >= NUM_LANES) return 0;
+    return lane_top_class(&lanes[lane_id]) <= urgent_class_limit(policy);
+}
+
+int is_any_emergency_active_with(const SchedulerPolicy* policy, LaneQueue lanes[]) {
+    for (int i = 0; i < NUM_LANES; i++) {
+        if (has_emergency_with(policy, lanes, i)) return 1;
     }
+    return 0;
+}
+
+// Emergency lanes first, by class and Round Robin from the current one
+// exactly as in select_next_lane_in; the policy only chooses among normal lanes
+int select_next_lane_with(const SchedulerPolicy* policy, LaneQueue lanes[], int current_lane, const LaneEstimate est[]) {
+    int lane = select_next_lane_in(lanes, current_lane);
+    if (lane != -1 && has_emergency_with(policy, lanes, lane)) return lane;
+    return policy->next_lane(lanes, current_lane, est);
+}
+
+// ---------------- Scheduler Policies ----------------
+
+static int fixed_next_lane(LaneQueue lanes[], int current_lane, const LaneEstimate est[]) {
+    (void)est;
+    return select_next_lane_in(lanes, current_lane);
+}
+
+static int64_t fixed_green_time(LaneQueue lanes[], int lane, const LaneEstimate est[], const GreenLimits* lim) {
+    (void)lanes; (void)lane; (void)est;
+    return lim->green_ns;
+}
 
-    // 2. Normal Loop: Round Robin for any car
-    // Note: If ANY emergency exists anywhere, we should NOT return a normal lane here
-    // unless that logic is handled in main. 
-    // Actually, strict priority means if ANY emergency exists, we must only pick emergency.
-    // The loop 1 above covers it. If loop 1 fails, it means NO emergency exists anywhere.
-    
+const SchedulerPolicy scheduler_fixed = { "fixed", fixed_next_lane, fixed_green_time, 1 };
+
+// Max-pressure for an isolated junction: every discharge leaves the system,
+// so a lane's pressure is simply its queue. Ties go Round Robin from the
+// lane after the current one. Light lanes cannot starve: once their oldest
+// car has aged past AGING_THRESHOLD they are served first, with a full green.
+static int pressure_next_lane(LaneQueue lanes[], int current_lane, const LaneEstimate est[]) {
+    (void)est;
     for (int i = 1; i <= NUM_LANES; i++) {
         int idx = (current_lane + i) % NUM_LANES;
-        if (lane_queues[idx] != NULL) return idx;
+        if (has_emergency_in(lanes, idx)) return idx; // Aged
     }
-    
-    return -1; // All empty
-}
-
-void enter_intersection(int lane_id) {
-    // Critical Section
-    pthread_mutex_lock(&intersection_mutex);
-    
-    current_green_lane = lane_id;
-    
-    // Simulate traffic flow
-    // Process 1 car from this lane
-    pthread_mutex_lock(&queue_mutex);
-    if (lane_queues[lane_id] != NULL) {
-        remove_vehicle(&lane_queues[lane_id]);
-        // Note: In real world, multiple cars go during Green.
-        // Here we can process one or few.
-        // Let's pretend we process 1 car per cycle for slower visual.
-        
-        // Apply Aging to others
-        for(int i=0; i<NUM_LANES; i++) handle_aging(&lane_queues[i]);
+
+    int best = -1;
+    int best_queue = 0;
+    for (int i = 1; i <= NUM_LANES; i++) {
+        int idx = (current_lane + i) % NUM_LANES;
+        int queue = count_vehicles(&lanes[idx]);
+        if (queue > best_queue) {
+            best = idx;
+            best_queue = queue;
+        }
     }
-    pthread_mutex_unlock(&queue_mutex);
+    return best;
+}
 
-    // Sleep to simulate crossing time
-    usleep(500000); // 0.5s
-    
-    current_green_lane = -1; // Yellow/Red
-    
-    pthread_mutex_unlock(&intersection_mutex);
+// Long enough to clear the queue plus what arrives meanwhile: serving Q
+// cars at headway h while cars keep coming at rate a takes Q*h / (1 - a*h).
+// The controller still cuts the green short if the lane drains early.
+static int64_t pressure_green_time(LaneQueue lanes[], int lane, const LaneEstimate est[], const GreenLimits* lim) {
+    double h = lim->headway_ns / 1e9;
+    double load = est ? est[lane].arrival_rate * h : 0.0;
+    double green = lim->max_green_ns;
+    if (load < 0.95) green = count_vehicles(&lanes[lane]) * lim->headway_ns / (1.0 - load);
+    if (green < lim->min_green_ns) green = lim->min_green_ns;
+    if (green > lim->max_green_ns) green = lim->max_green_ns;
+    return (int64_t)green;
+}
+
+const SchedulerPolicy scheduler_max_pressure = { "max-pressure", pressure_next_lane, pressure_green_time, 0 };
+
+const SchedulerPolicy* scheduler_find(const char* name) {
+    if (strcmp(name, scheduler_fixed.name) == 0) return &scheduler_fixed;
+    if (strcmp(name, scheduler_max_pressure.name) == 0) return &scheduler_max_pressure;
+    return NULL;
 }
 
 void cleanup_traffic_system() {
-    pthread_mutex_destroy(&intersection_mutex);
-    pthread_mutex_destroy(&queue_mutex);
-    // Free lists if needed
+    for (int i = 0; i < NUM_LANES; i++) {
+        free_lane_queue(&lane_queues[i]);
+        lane_intake_free(&lane_intakes[i]);
+    }
 }
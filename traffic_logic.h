@@ -3,12 +3,15 @@
 
 #include <pthread.h>
 #include "utils.h"
+#include "lane_intake.h"
+#include "sensor.h"
 
 // Shared Resources
-extern Node* lane_queues[NUM_LANES];
-extern pthread_mutex_t intersection_mutex;
-extern pthread_mutex_t queue_mutex; // Protects linked lists
-extern int current_green_lane; // -1 if all red
+// Lanes are owned by the controller thread; other threads hand vehicles
+// over through the lock-free per-lane intakes (submit_vehicle)
+extern LaneQueue lane_queues[NUM_LANES];
+extern LaneIntake lane_intakes[NUM_LANES];
+extern LaneSensor lane_sensors[NUM_LANES]; // Lock-free demand estimates per lane
 
 // Thread Structure for Sensors
 typedef struct {
@@ -16,14 +19,64 @@ typedef struct {
     char lane_name[10];
 } SensorArgs;
 
+// Conflict matrix: one through movement per approach, bit j of
+// conflicts[i] set when approaches i and j must not be green together
+typedef unsigned LaneMask;
+#define LANE_BIT(i) ((LaneMask)1u << (i))
+extern const LaneMask conflicts_through[NUM_LANES];   // North+South or East+West together
+extern const LaneMask conflicts_exclusive[NUM_LANES]; // One approach at a time
+// Lead approach plus every candidate that conflicts with nothing already chosen
+LaneMask compatible_phase(const LaneMask conflicts[], int lead, LaneMask candidates);
+
+// Phase schedulers: which lane gets the next normal green and for how long.
+// Emergency vehicles always go first (select_next_lane_in), so a policy is
+// only asked when none is waiting and cannot weaken preemption. Aged cars
+// are emergencies under the legacy rules; a policy may instead handle them
+// itself (aged_cars_preempt = 0), serving their lane with a full green.
+typedef struct {
+    int64_t green_ns;     // Fixed-time green
+    int64_t min_green_ns; // Adaptive bounds
+    int64_t max_green_ns;
+    int64_t headway_ns;   // Time to discharge one queued vehicle
+} GreenLimits;
+
+typedef struct {
+    const char* name;
+    // est[] is NULL when no demand estimates are available
+    int (*next_lane)(LaneQueue lanes[], int current_lane, const LaneEstimate est[]);
+    int64_t (*green_time)(LaneQueue lanes[], int lane, const LaneEstimate est[], const GreenLimits* lim);
+    int aged_cars_preempt;
+} SchedulerPolicy;
+
+// Least urgent class that preempts a normal green under the policy
+static inline int urgent_class_limit(const SchedulerPolicy* policy) {
+    return policy->aged_cars_preempt ? CLASS_AGED : CLASS_POLICE;
+}
+
+extern const SchedulerPolicy scheduler_fixed;        // Round Robin, fixed green (default)
+extern const SchedulerPolicy scheduler_max_pressure; // Longest queue first, green sized to clear it
+const SchedulerPolicy* scheduler_find(const char* name); // NULL if unknown
+
 // Functions
 void init_traffic_system();
+#define SUBMIT_OK 0
+#define SUBMIT_FULL 1     // Intake full: drain it and retry
+#define SUBMIT_INVALID -1 // Lane or type out of range: drop it
+int submit_vehicle(const Vehicle* v); // Any thread
 void* sensor_thread(void* arg);
 int select_next_lane(int current_lane);
-void enter_intersection(int lane_id);
-void handle_aging(Node** head);
+void handle_aging(LaneQueue* q);
+void handle_aging_by(LaneQueue* q, int passes); // `passes` vehicles served in one batch
 void cleanup_traffic_system();
 int has_emergency(int lane_id);
 int is_any_emergency_active();
 
+// Instance variants: same rules on an explicit set of lanes
+int select_next_lane_in(LaneQueue lanes[], int current_lane);
+int has_emergency_in(LaneQueue lanes[], int lane_id);
+int is_any_emergency_active_in(LaneQueue lanes[]);
+int has_emergency_with(const SchedulerPolicy* policy, LaneQueue lanes[], int lane_id);
+int is_any_emergency_active_with(const SchedulerPolicy* policy, LaneQueue lanes[]);
+int select_next_lane_with(const SchedulerPolicy* policy, LaneQueue lanes[], int current_lane, const LaneEstimate est[]);
+
 #endif
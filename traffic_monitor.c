@@ -0,0 +1,136 @@
+// Standalone reader for the live controller's state page (state_page.h).
+// It only maps the page read-only, so any number can run beside the
+// controller without slowing it down.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "state_page.h"
+
+static const char* lane_names[NUM_LANES] = { "NORTH", "SOUTH", "EAST", "WEST" };
+static const char* phase_names[] = { "IDLE", "GREEN", "ALL_RED" };
+static const char* flow_names[] = { "crossing", "gap", "empty", "done" };
+
+static volatile sig_atomic_t keep_running = 1;
+
+static void handle_sigint(int sig) {
+    keep_running = 0;
+}
+
+static void print_usage(const char* prog) {
+    printf("Usage: %s [--interval MS] [--count N] [--csv] [--max-age MS]\n"
+           "  Prints the running controller's state every MS milliseconds (default 1000).\n"
+           "  --count N     stop after N snapshots (default: until Ctrl+C)\n"
+           "  --csv         one CSV row per snapshot instead of the lane table\n"
+           "  --max-age MS  watchdog: exit 3 once the controller has not published for MS\n"
+           "  Exit status: 1 no controller running, 2 controller shut down, 3 stale or stuck\n", prog);
+}
+
+static void print_green(unsigned mask) {
+    if (mask == 0) {
+        printf("none");
+        return;
+    }
+    const char* sep = "";
+    for (int i = 0; i < NUM_LANES; i++) {
+        if (mask & (1u << i)) {
+            printf("%s%s", sep, lane_names[i]);
+            sep = ",";
+        }
+    }
+}
+
+static void print_table(const StateSnapshot* s, int64_t now, int retries) {
+    printf("phase %-7s green ", s->phase >= 0 && s->phase <= 2 ? phase_names[s->phase] : "?");
+    print_green(s->green_mask);
+    if (s->emergency_round) printf(" (emergency round)");
+    if (s->deadline_ns != SIM_TIME_NEVER) printf(", next step in %.2f s", (s->deadline_ns - now) / 1e9);
+    printf(", %lld phases (%lld preempted), update %llu, %.1f ms old, %d retries\n", (long long)s->phases,
+           (long long)s->preemptions, (unsigned long long)s->updates, (now - s->updated_ns) / 1e6, retries);
+    for (int i = 0; i < NUM_LANES; i++) {
+        const StateLane* l = &s->lanes[i];
+        printf("  %-5s %6d queued %3d emerg  in %lld out %lld", lane_names[i], l->count, l->emergencies,
+               (long long)l->arrivals, (long long)l->departures);
+        if (s->green_mask & (1u << i)) printf("  [%s]", l->flow >= 0 && l->flow <= 3 ? flow_names[l->flow] : "?");
+        if (l->crossing.id != -1) printf("  crossing #%d %s", l->crossing.id, get_vehicle_type_str(l->crossing.type));
+        if (l->head_count > 0) printf("  next:");
+        for (int k = 0; k < l->head_count; k++) {
+            printf(" #%d %s %.1fs", l->head[k].id, get_vehicle_type_str(l->head[k].type),
+                   (now - l->head[k].arrival_ns) / 1e9);
+        }
+        printf("\n");
+    }
+    fflush(stdout);
+}
+
+static void print_csv(const StateSnapshot* s, int64_t now) {
+    printf("%.3f,%d,%u,%lld,%lld", (now - s->updated_ns) / 1e6, s->phase, s->green_mask, (long long)s->phases,
+           (long long)s->preemptions);
+    for (int i = 0; i < NUM_LANES; i++) {
+        printf(",%d,%d,%lld,%lld", s->lanes[i].count, s->lanes[i].emergencies, (long long)s->lanes[i].arrivals,
+               (long long)s->lanes[i].departures);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+    double interval_ms = 1000;
+    long long count = 0;
+    int csv = 0;
+    double max_age_ms = 0;
+    for (int i = 1; i < argc; i++) {
+        int has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--interval") == 0 && has_value) interval_ms = atof(argv[++i]);
+        else if (strcmp(argv[i], "--count") == 0 && has_value) count = atoll(argv[++i]);
+        else if (strcmp(argv[i], "--csv") == 0) csv = 1;
+        else if (strcmp(argv[i], "--max-age") == 0 && has_value) max_age_ms = atof(argv[++i]);
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (interval_ms <= 0) interval_ms = 1000;
+
+    const StatePage* page = state_page_attach(STATE_PAGE_NAME);
+    if (page == NULL) {
+        fprintf(stderr, "no controller state page (is traffic_system running live?)\n");
+        return 1;
+    }
+    signal(SIGINT, handle_sigint);
+    printf("Attached to controller pid %d\n", page->writer_pid);
+    if (csv) {
+        printf("age_ms,phase,green_mask,phases,preemptions");
+        for (int i = 0; i < NUM_LANES; i++) printf(",%s_queued,%s_emerg,%s_in,%s_out", lane_names[i], lane_names[i], lane_names[i], lane_names[i]);
+        printf("\n");
+    }
+
+    int rc = 0;
+    int64_t next = monotonic_ns();
+    for (long long n = 0; keep_running && (count == 0 || n < count); n++) {
+        StateSnapshot s;
+        int retries = state_page_read(page, &s);
+        int64_t now = monotonic_ns();
+        if (retries < 0) {
+            fprintf(stderr, "controller stuck mid-update (crashed?)\n");
+            rc = 3;
+            break;
+        }
+        if (csv) print_csv(&s, now);
+        else print_table(&s, now, retries);
+        if (!atomic_load(&page->live)) {
+            fprintf(stderr, "controller shut down\n");
+            rc = 2;
+            break;
+        }
+        if (max_age_ms > 0 && now - s.updated_ns > (int64_t)(max_age_ms * 1e6)) {
+            fprintf(stderr, "controller silent for %.0f ms\n", (now - s.updated_ns) / 1e6);
+            rc = 3;
+            break;
+        }
+        next += (int64_t)(interval_ms * 1e6);
+        if (count == 0 || n + 1 < count) sleep_until_ns(next); // Ctrl+C interrupts the sleep
+    }
+    state_page_detach(page);
+    return rc;
+}
@@ -1,7 +1,6 @@
 #include "utils.h"
 
 // History Log
-#define MAX_HISTORY 5
 static Vehicle history_log[MAX_HISTORY];
 static int history_count = 0;
 
@@ -14,72 +13,435 @@ void log_vehicle(Vehicle v) {
     if (history_count < MAX_HISTORY) history_count++;
 }
 
-// Linked List: Add to tail
-void add_vehicle(Node** head, Vehicle v) {
-    Node* new_node = (Node*)malloc(sizeof(Node));
-    new_node->vehicle = v;
-    new_node->next = NULL;
+// Lane Queue
+// All-zero: also detached from any priority index
+void init_lane_queue(LaneQueue* q) {
+    memset(q, 0, sizeof(*q));
+}
 
-    if (*head == NULL) {
-        *head = new_node;
-        return;
+void free_lane_queue(LaneQueue* q) {
+    if (q->chunks) {
+        for (size_t i = 0; i <= q->chunk_mask; i++) free(q->chunks[i]);
+        free(q->chunks);
     }
+    for (int k = 0; k < NUM_EMERGENCY_CLASSES; k++) free(q->emergency[k].pos);
+    free(q->spare);
+    init_lane_queue(q);
+}
 
-    Node* temp = *head;
-    while (temp->next != NULL) {
-        temp = temp->next;
+static LaneChunk* acquire_chunk(LaneQueue* q) {
+    LaneChunk* c = q->spare;
+    if (c) {
+        q->spare = NULL;
+        return c;
     }
-    temp->next = new_node;
+    return (LaneChunk*)malloc(sizeof(LaneChunk));
 }
 
-// Priority Remove: Search for Emergency first, else Head
-Vehicle remove_vehicle(Node** head) {
-    Vehicle v = { -1, -1, -1, 0, 0 };
-    if (*head == NULL) return v;
-
-    // 1. Scan for Emergency
-    Node* temp = *head;
-    Node* prev = NULL;
-    Node* target = NULL;
-    Node* target_prev = NULL;
-
-    while (temp != NULL) {
-        if (temp->vehicle.type != REGULAR_CAR) {
-            target = temp;
-            target_prev = prev;
-            break; // Found one, take it immediately
+static void release_chunk(LaneQueue* q, uint64_t chunk_no) {
+    LaneChunk** ref = &q->chunks[chunk_no & q->chunk_mask];
+    if (q->spare == NULL) q->spare = *ref;
+    else free(*ref);
+    *ref = NULL;
+}
+
+// Make room in the chunk ring for chunk numbers head..chunk_no
+static void reserve_chunk_ring(LaneQueue* q, uint64_t chunk_no) {
+    uint64_t first = q->head >> LANE_CHUNK_SHIFT;
+    size_t needed = (size_t)(chunk_no - first + 1);
+    size_t capacity = q->chunks ? q->chunk_mask + 1 : 0;
+    if (needed <= capacity) return;
+
+    size_t new_capacity = capacity ? capacity : 8;
+    while (new_capacity < needed) new_capacity *= 2;
+    LaneChunk** ring = (LaneChunk**)calloc(new_capacity, sizeof(LaneChunk*));
+    if (q->chunks) {
+        for (uint64_t k = first; k < chunk_no; k++) {
+            ring[k & (new_capacity - 1)] = q->chunks[k & q->chunk_mask];
         }
-        prev = temp;
-        temp = temp->next;
+        free(q->chunks);
     }
+    q->chunks = ring;
+    q->chunk_mask = new_capacity - 1;
+}
 
-    // 2. If no emergency, take head
-    if (target == NULL) {
-        target = *head;
-        target_prev = NULL;
+static void fifo_push(PositionFifo* f, uint64_t pos) {
+    size_t used = (size_t)(f->tail - f->head);
+    size_t capacity = f->pos ? f->mask + 1 : 0;
+    if (used == capacity) {
+        size_t new_capacity = capacity ? capacity * 2 : 16;
+        uint64_t* ring = (uint64_t*)malloc(new_capacity * sizeof(uint64_t));
+        for (uint64_t k = f->head; k < f->tail; k++) {
+            ring[k & (new_capacity - 1)] = f->pos[k & f->mask];
+        }
+        free(f->pos);
+        f->pos = ring;
+        f->mask = new_capacity - 1;
     }
+    f->pos[f->tail++ & f->mask] = pos;
+}
 
-    // 3. Remove Target
-    v = target->vehicle;
-    
-    if (target_prev == NULL) {
-        *head = target->next; // Head was removed
-    } else {
-        target_prev->next = target->next; // Middle removed
+static void push_emergency(LaneQueue* q, int cls, uint64_t pos) {
+    fifo_push(&q->emergency[cls], pos);
+    q->emergency_classes |= 1u << cls;
+}
+
+// Most urgent class, oldest first
+static uint64_t pop_emergency(LaneQueue* q) {
+    int cls = __builtin_ctz(q->emergency_classes);
+    PositionFifo* f = &q->emergency[cls];
+    uint64_t pos = f->pos[f->head++ & f->mask];
+    if (f->head == f->tail) q->emergency_classes &= ~(1u << cls);
+    return pos;
+}
+
+// ---------------- Priority index ----------------
+
+// Refile the lane under its current most urgent class: O(1)
+static void lane_reindex(LaneQueue* q) {
+    PriorityIndex* x = q->index;
+    if (x == NULL) return;
+    int lane = q->index_lane;
+    int cls = lane_top_class(q);
+    int old = x->top[lane];
+    if (cls == old) return;
+    uint32_t bit = 1u << lane;
+    if (old != CLASS_NONE && (x->lanes[old] &= ~bit) == 0) x->classes &= ~(1u << old);
+    if (cls != CLASS_NONE) {
+        x->lanes[cls] |= bit;
+        x->classes |= 1u << cls;
+    }
+    x->top[lane] = (int8_t)cls;
+}
+
+void priority_index_attach(PriorityIndex* x, LaneQueue lanes[], int n) {
+    memset(x, 0, sizeof(*x));
+    memset(x->top, CLASS_NONE, sizeof(x->top));
+    for (int i = 0; i < n && i < INDEX_MAX_LANES; i++) {
+        lanes[i].index = x;
+        lanes[i].index_lane = i;
+        lane_reindex(&lanes[i]);
+    }
+}
+
+int priority_index_next(const PriorityIndex* x, int current, int max_class) {
+    int cls = priority_index_top_class(x);
+    if (cls > max_class) return -1;
+    uint32_t m = x->lanes[cls];
+    // Lanes after the current one first, then from the lowest (wrap around)
+    uint32_t after = current + 1 < INDEX_MAX_LANES ? m & (~0u << (current + 1)) : 0;
+    return __builtin_ctz(after ? after : m);
+}
+
+// ---------------- Type scans ----------------
+// First index in t[0, n) whose type equals `value` (match = 1) or differs
+// from it (match = 0); n if none. x86 uses AVX2 when the CPU has it, else
+// SSE2; other targets (or -DLANE_SCAN_SCALAR) use the scalar loop.
+static size_t find_type_scalar(const int8_t* t, size_t n, int8_t value, int match) {
+    for (size_t i = 0; i < n; i++) {
+        if ((t[i] == value) == match) return i;
+    }
+    return n;
+}
+
+#if defined(__SSE2__) && !defined(LANE_SCAN_SCALAR)
+#include <immintrin.h>
+
+static size_t find_type_sse2(const int8_t* t, size_t n, int8_t value, int match) {
+    __m128i v = _mm_set1_epi8(value);
+    unsigned flip = match ? 0 : 0xFFFFu;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(t + i));
+        unsigned m = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, v)) ^ flip;
+        if (m) return i + __builtin_ctz(m);
+    }
+    return i + find_type_scalar(t + i, n - i, value, match);
+}
+
+__attribute__((target("avx2")))
+static size_t find_type_avx2(const int8_t* t, size_t n, int8_t value, int match) {
+    __m256i v = _mm256_set1_epi8(value);
+    unsigned flip = match ? 0 : 0xFFFFFFFFu;
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(t + i));
+        unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, v)) ^ flip;
+        if (m) return i + __builtin_ctz(m);
+    }
+    _mm256_zeroupper(); // Not emitted before the call: dirty upper halves make the SSE2 tail crawl
+    return i + find_type_sse2(t + i, n - i, value, match);
+}
+
+static size_t find_type(const int8_t* t, size_t n, int8_t value, int match) {
+    if (__builtin_cpu_supports("avx2")) return find_type_avx2(t, n, value, match);
+    return find_type_sse2(t, n, value, match);
+}
+#else
+#define find_type find_type_scalar
+#endif
+
+// Same, over queue positions [pos, end): one scan per chunk segment. Short
+// gaps are the norm, so the first few slots are probed before any vector
+// scan is set up.
+#define SCAN_PROBE 8
+#define SCAN_PREFETCH_CHUNKS 4 // Chunks are separate blocks: the hardware prefetcher stops at each one
+
+__attribute__((noinline))
+static uint64_t scan_types_far(const LaneQueue* q, uint64_t pos, uint64_t end, int8_t value, int match) {
+    while (pos < end) {
+        uint64_t ahead = (pos & ~(uint64_t)(LANE_CHUNK_SIZE - 1)) + SCAN_PREFETCH_CHUNKS * LANE_CHUNK_SIZE;
+        if (ahead < end) {
+            const int8_t* t = lane_chunk(q, ahead)->type;
+            for (int line = 0; line < LANE_CHUNK_SIZE; line += 64) __builtin_prefetch(t + line);
+        }
+        size_t offset = pos & (LANE_CHUNK_SIZE - 1);
+        size_t n = LANE_CHUNK_SIZE - offset;
+        if (n > end - pos) n = (size_t)(end - pos);
+        size_t i = find_type(lane_chunk(q, pos)->type + offset, n, value, match);
+        if (i < n) return pos + i;
+        pos += n;
+    }
+    return end;
+}
+
+static inline uint64_t scan_types(const LaneQueue* q, uint64_t pos, uint64_t end, int8_t value, int match) {
+    for (int k = 0; k < SCAN_PROBE && pos < end; k++, pos++) {
+        if ((lane_chunk(q, pos)->type[pos & (LANE_CHUNK_SIZE - 1)] == value) == match) return pos;
+    }
+    return scan_types_far(q, pos, end, value, match);
+}
+
+// ---------------- Slots ----------------
+
+static int slot_priority(const LaneQueue* q, const LaneChunk* c, size_t i) {
+    if (c->type[i] != REGULAR_CAR) return (int)c->priority[i];
+    return (int)(q->age_epoch - c->priority[i]); // Gains 1 per aging pass
+}
+
+static void load_slot(const LaneQueue* q, uint64_t pos, Vehicle* v) {
+    const LaneChunk* c = lane_chunk(q, pos);
+    size_t i = pos & (LANE_CHUNK_SIZE - 1);
+    v->id = c->id[i];
+    v->type = c->type[i];
+    v->lane = c->lane[i];
+    v->arrival_time = (time_t)(q->time_base + c->arrival_sec[i]);
+    v->arrival_ns = c->arrival_ns[i];
+    v->priority_score = slot_priority(q, c, i);
+}
+
+static void store_slot(LaneQueue* q, uint64_t pos, const Vehicle* v) {
+    LaneChunk* c = lane_chunk(q, pos);
+    size_t i = pos & (LANE_CHUNK_SIZE - 1);
+    c->type[i] = (int8_t)v->type;
+    c->lane[i] = (uint8_t)v->lane;
+    c->id[i] = v->id;
+    c->arrival_sec[i] = (int32_t)((int64_t)v->arrival_time - q->time_base);
+    c->arrival_ns[i] = v->arrival_ns;
+    c->priority[i] = v->type == REGULAR_CAR ? q->age_epoch - (unsigned)v->priority_score : (uint32_t)v->priority_score;
+}
+
+static void clear_slot(LaneQueue* q, uint64_t pos) {
+    lane_chunk(q, pos)->type[pos & (LANE_CHUNK_SIZE - 1)] = VEHICLE_REMOVED;
+}
+
+// ---------------- Summary ----------------
+
+// Count the regular cars that have reached the threshold since the last
+// call. The marker only moves forward, so each slot is passed over at most
+// once (O(1) amortized); a call with nothing newly aged costs one probe.
+static void count_aged(LaneQueue* q) {
+    LaneSummary* s = &q->summary;
+    int threshold = q->aging_threshold ? q->aging_threshold : AGING_THRESHOLD;
+    uint64_t pos = s->next_unaged > q->head ? s->next_unaged : q->head; // Head may have passed a served marker
+    for (;;) {
+        pos = scan_types(q, pos, q->tail, REGULAR_CAR, 1);
+        if (pos == q->tail) break;
+        const LaneChunk* c = lane_chunk(q, pos);
+        if (slot_priority(q, c, pos & (LANE_CHUNK_SIZE - 1)) < threshold) break;
+        s->aged++;
+        pos++;
+    }
+    s->next_unaged = pos;
+}
+
+static void summary_add(LaneQueue* q, uint64_t pos, int type) {
+    LaneSummary* s = &q->summary;
+    s->by_type[type]++;
+    if (s->window_count < LANE_WINDOW) s->window[s->window_count++] = pos;
+    if (type == REGULAR_CAR) count_aged(q); // Restored cars may arrive aged
+}
+
+// The window refills from past its last entry, which only moves forward:
+// O(1) amortized like the head
+static void summary_remove(LaneQueue* q, uint64_t pos, int type) {
+    LaneSummary* s = &q->summary;
+    s->by_type[type]--;
+    if (type == REGULAR_CAR && pos < s->next_unaged) s->aged--;
+
+    int k = 0;
+    while (k < s->window_count && s->window[k] != pos) k++;
+    if (k == s->window_count) return;
+    uint64_t last = s->window[s->window_count - 1];
+    int was_full = s->window_count == LANE_WINDOW;
+    memmove(&s->window[k], &s->window[k + 1], (size_t)(s->window_count - k - 1) * sizeof(uint64_t));
+    s->window_count--;
+    if (was_full) {
+        uint64_t next = scan_types(q, last + 1, q->tail, VEHICLE_REMOVED, 0);
+        if (next < q->tail) s->window[s->window_count++] = next;
+    }
+}
+
+// Advance head over served slots, handing back chunks it leaves behind
+static void compact_head(LaneQueue* q) {
+    uint64_t live = scan_types(q, q->head, q->tail, VEHICLE_REMOVED, 0);
+    for (uint64_t k = q->head >> LANE_CHUNK_SHIFT; k < live >> LANE_CHUNK_SHIFT; k++) release_chunk(q, k);
+    q->head = live;
+    // Empty mid-chunk: the next add starts a fresh chunk
+    if (q->head == q->tail && (q->head & (LANE_CHUNK_SIZE - 1)) != 0) {
+        release_chunk(q, q->head >> LANE_CHUNK_SHIFT);
+    }
+}
+
+// Add to tail: O(1)
+void add_vehicle(LaneQueue* q, Vehicle v) {
+    if (q->tail == 0) q->time_base = (int64_t)v.arrival_time;
+    // A new chunk is needed at a chunk boundary or when the queue drained
+    if (q->head == q->tail || (q->tail & (LANE_CHUNK_SIZE - 1)) == 0) {
+        uint64_t chunk_no = q->tail >> LANE_CHUNK_SHIFT;
+        reserve_chunk_ring(q, chunk_no);
+        q->chunks[chunk_no & q->chunk_mask] = acquire_chunk(q);
+    }
+
+    uint64_t pos = q->tail++;
+    store_slot(q, pos, &v);
+    q->count++;
+    if (v.type != REGULAR_CAR) push_emergency(q, vehicle_class(v.type), pos);
+    summary_add(q, pos, v.type);
+    lane_reindex(q);
+}
+
+// Mark a slot served and take it out of the summary
+static void forget_slot(LaneQueue* q, uint64_t pos, int type) {
+    clear_slot(q, pos);
+    q->count--;
+    summary_remove(q, pos, type);
+}
+
+// Priority Remove: most urgent Emergency if any, else Head. O(1) amortized.
+Vehicle remove_vehicle(LaneQueue* q) {
+    Vehicle v = { -1, -1, -1, 0, 0 };
+    if (q->count == 0) return v;
+
+    uint64_t pos = q->head; // compact_head keeps head on a live slot
+    if (q->emergency_classes) pos = pop_emergency(q);
+
+    load_slot(q, pos, &v);
+    forget_slot(q, pos, v.type);
+    compact_head(q);
+    lane_reindex(q);
+    return v;
+}
+
+// Batch dequeue in strict queue order: stops at the first emergency
+// vehicle, which only remove_vehicle may serve (it jumps the queue)
+int remove_head_vehicles(LaneQueue* q, Vehicle* out, int max) {
+    int n = 0;
+    while (n < max && q->count > 0) {
+        uint64_t pos = q->head; // compact_head keeps head on a live slot
+        if (lane_chunk(q, pos)->type[pos & (LANE_CHUNK_SIZE - 1)] != REGULAR_CAR) break;
+        load_slot(q, pos, &out[n]);
+        forget_slot(q, pos, REGULAR_CAR);
+        compact_head(q);
+        n++;
+    }
+    if (n > 0) lane_reindex(q);
+    return n;
+}
+
+// Linear in the vehicles ahead of it: for rare out-of-order removals
+// (checkpoint recovery), not for serving
+Vehicle remove_vehicle_by_id(LaneQueue* q, int id) {
+    Vehicle v = { -1, -1, -1, 0, 0 };
+    for (uint64_t pos = q->head; pos < q->tail; pos++) {
+        const LaneChunk* c = lane_chunk(q, pos);
+        size_t i = pos & (LANE_CHUNK_SIZE - 1);
+        if (c->type[i] == VEHICLE_REMOVED || c->id[i] != id) continue;
+
+        load_slot(q, pos, &v);
+        forget_slot(q, pos, v.type);
+        if (v.type != REGULAR_CAR) {
+            // Close the gap in its class FIFO
+            int cls = vehicle_class(v.type);
+            PositionFifo* f = &q->emergency[cls];
+            uint64_t k = f->head;
+            while (f->pos[k & f->mask] != pos) k++;
+            for (; k + 1 < f->tail; k++) f->pos[k & f->mask] = f->pos[(k + 1) & f->mask];
+            if (--f->tail == f->head) q->emergency_classes &= ~(1u << cls);
+        }
+        compact_head(q);
+        lane_reindex(q);
+        break;
     }
-    
-    free(target);
     return v;
 }
 
-// Count nodes
-int count_vehicles(Node* head) {
-    int count = 0;
-    while (head != NULL) {
-        count++;
-        head = head->next;
+int count_vehicles(const LaneQueue* q) {
+    return q->count;
+}
+
+int count_vehicles_of_type(const LaneQueue* q, int type) {
+    return q->summary.by_type[type];
+}
+
+int count_aged_vehicles(const LaneQueue* q) {
+    return q->summary.aged;
+}
+
+// Lazy: one epoch tick per pass; each car's score is derived on demand
+// from the epochs elapsed since it was queued
+void age_lane(LaneQueue* q, int passes) {
+    q->age_epoch += passes;
+    count_aged(q);
+    lane_reindex(q);
+}
+
+int lane_has_emergency_vehicle(const LaneQueue* q) {
+    return q->emergency_classes != 0;
+}
+
+int first_emergency_vehicle(const LaneQueue* q, Vehicle* out) {
+    if (q->emergency_classes == 0) return 0;
+    const PositionFifo* f = &q->emergency[__builtin_ctz(q->emergency_classes)];
+    load_slot(q, f->pos[f->head & f->mask], out);
+    return 1;
+}
+
+// The first LANE_WINDOW come from the summary; only longer peeks scan on
+int peek_vehicles(const LaneQueue* q, Vehicle* out, int max) {
+    const LaneSummary* s = &q->summary;
+    int n = 0;
+    for (; n < max && n < s->window_count; n++) load_slot(q, s->window[n], &out[n]);
+    if (n < max && n == LANE_WINDOW) {
+        for (uint64_t pos = s->window[LANE_WINDOW - 1] + 1; n < max; pos++) {
+            pos = scan_types(q, pos, q->tail, VEHICLE_REMOVED, 0);
+            if (pos == q->tail) break;
+            load_slot(q, pos, &out[n++]);
+        }
     }
-    return count;
+    return n;
+}
+
+int64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Absolute deadlines do not drift with the time spent between sleeps
+int sleep_until_ns(int64_t deadline) {
+    struct timespec ts = { deadline / 1000000000LL, deadline % 1000000000LL };
+    return clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == 0 ? 0 : -1;
 }
 
 // UI Helpers
@@ -100,74 +462,117 @@ const char* get_vehicle_type_str(int type) {
     }
 }
 
-void draw_traffic_scene(Node* lanes[], int green_lane_idx, Vehicle* crossing_v) {
+// Copies what one frame shows; the caller holds the lanes' lock. Cheap
+// (read off each lane's summary), so the frame itself can be drawn
+// without the lock.
+void capture_scene(SceneSnapshot* s, LaneQueue lanes[], unsigned green_mask, const Vehicle crossing[]) {
+    s->green_mask = green_mask;
+    s->crossing_count = 0;
+    for (int i = 0; crossing && i < NUM_LANES; i++) {
+        if (crossing[i].id != -1) s->crossing[s->crossing_count++] = crossing[i];
+    }
+    for (int i = 0; i < NUM_LANES; i++) {
+        s->lane_count[i] = count_vehicles(&lanes[i]);
+        s->lane_emergency[i] = lane_has_emergency_vehicle(&lanes[i]);
+        s->lane_aged[i] = count_aged_vehicles(&lanes[i]);
+        s->preview_count[i] = peek_vehicles(&lanes[i], s->preview[i], SCENE_PREVIEW);
+    }
+    s->history_count = history_count;
+    memcpy(s->history, history_log, sizeof(Vehicle) * history_count);
+    s->has_sensors = 0;
+}
+
+void draw_traffic_scene(LaneQueue lanes[], unsigned green_mask, const Vehicle crossing[]) {
+    draw_traffic_scene_to(stdout, lanes, green_mask, crossing);
+}
+
+// Same frame, written to any stream (a memory buffer for benchmarks or an
+// off-screen frame)
+void draw_traffic_scene_to(FILE* out, LaneQueue lanes[], unsigned green_mask, const Vehicle crossing[]) {
+    SceneSnapshot snap;
+    capture_scene(&snap, lanes, green_mask, crossing);
+    draw_scene_snapshot(out, &snap);
+}
+
+void draw_scene_snapshot(FILE* out, const SceneSnapshot* snap) {
+    unsigned green_mask = snap->green_mask;
+    const Vehicle* crossing_v = snap->crossing_count > 0 ? &snap->crossing[0] : NULL; // Junction art shows the first; the log lists all
+
     // 1. DATA TABLE
-    printf(BOLD CYAN "==============================================================================\n");
-    printf("                       SMART CITY TRAFFIC CONTROL SYSTEM       \n");
-    printf("==============================================================================\n" RESET);
-
-    printf(BOLD CYAN "  SMART TRAFFIC DASHBOARD  \n" RESET);
-    printf(" +-------+-------+--------+------------------+------------------------------+\n");
-    printf(" | LANE  | STATE | Q-SIZE | STATUS           | VEHICLES (First 5)           |\n");
-    printf(" +-------+-------+--------+------------------+------------------------------+\n");
+    fprintf(out, BOLD CYAN "==============================================================================\n");
+    fprintf(out, "                       SMART CITY TRAFFIC CONTROL SYSTEM       \n");
+    fprintf(out, "==============================================================================\n" RESET);
+
+    fprintf(out, BOLD CYAN "  SMART TRAFFIC DASHBOARD  \n" RESET);
+    fprintf(out, " +-------+-------+--------+------------------+------------------------------+\n");
+    fprintf(out, " | LANE  | STATE | Q-SIZE | STATUS           | VEHICLES (First 5)           |\n");
+    fprintf(out, " +-------+-------+--------+------------------+------------------------------+\n");
     
     char* dirs[] = {"NORTH", "SOUTH", "EAST ", "WEST "};
     for(int i=0; i<4; i++) {
-        char* st = (green_lane_idx == i) ? BOLD GREEN "GO   " RESET : RED "STOP " RESET;
-        int sz = count_vehicles(lanes[i]);
+        char* st = (green_mask & (1u << i)) ? BOLD GREEN "GO   " RESET : RED "STOP " RESET;
+        int sz = snap->lane_count[i];
         char note[64] = "";
         char v_list[128] = "";
         
-        // Scan for Emergency + Build ID String
-        Node* t = lanes[i];
-        int count = 0;
-        int emergency_found = 0;
+        // Emergency flag + Build ID String
+        int emergency_found = snap->lane_emergency[i];
+        const Vehicle* first = snap->preview[i];
+        int shown = snap->preview_count[i];
         
-        while(t) {
-            if(t->vehicle.type != REGULAR_CAR) emergency_found = 1;
-            
-            if (count < 5) {
-                char tmp[20];
-                const char* type_prefix = (t->vehicle.type == REGULAR_CAR) ? "C" : 
-                                          (t->vehicle.type == AMBULANCE) ? "A" : "P";
-                sprintf(tmp, "%s%d ", type_prefix, t->vehicle.id % 100);
-                strcat(v_list, tmp);
-            }
-            count++;
-            t = t->next;
+        for (int k = 0; k < shown; k++) {
+            char tmp[20];
+            const char* type_prefix = (first[k].type == REGULAR_CAR) ? "C" : 
+                                      (first[k].type == AMBULANCE) ? "A" : "P";
+            sprintf(tmp, "%s%d ", type_prefix, first[k].id % 100);
+            strcat(v_list, tmp);
         }
-        if (count > 5) strcat(v_list, "...");
+        if (sz > SCENE_PREVIEW) strcat(v_list, "...");
         
         if (emergency_found) strcpy(note, BOLD_RED_BLINK "EMERGENCY!      " RESET);
+        else if (snap->lane_aged[i] > 0) sprintf(note, "Aged (%d)", snap->lane_aged[i]);
         else strcpy(note, "Normal");
         
-        printf(" | %s | %s | %-6d | %-16s | %-28s |\n", dirs[i], st, sz, note, v_list);
+        fprintf(out, " | %s | %s | %-6d | %-16s | %-28s |\n", dirs[i], st, sz, note, v_list);
+    }
+    fprintf(out, " +-------+-------+--------+------------------+------------------------------+\n");
+
+    // 1b. SENSOR ESTIMATES
+    if (snap->has_sensors) {
+        fprintf(out, " | LANE  | ARRIVE/MIN | DEPART/MIN | AVG QUEUE | TREND/MIN |\n");
+        for (int i = 0; i < NUM_LANES; i++) {
+            const LaneEstimate* e = &snap->sensors[i];
+            fprintf(out, " | %s | %10.1f | %10.1f | %9.1f | %+9.1f |\n", dirs[i], e->arrival_rate * 60.0,
+                    e->discharge_rate * 60.0, e->queue_length, e->queue_trend * 60.0);
+        }
+        fprintf(out, " +-------+------------+------------+-----------+-----------+\n");
     }
-    printf(" +-------+-------+--------+------------------+------------------------------+\n");
 
     // 2. RECENT PROCESS LOG
-printf("\n");
-printf(BOLD CYAN "   RECENTLY PROCESSED VEHICLES  \n" RESET);
-printf(" +------------+----------+-----------------+----------------+\n");
-printf(" | VEHICLE ID | LANE     | TYPE            | STATUS         |\n");
-printf(" +------------+----------+-----------------+----------------+\n");
-
-// Show current crossing first if exists
-if (crossing_v) {
+fprintf(out, "\n");
+fprintf(out, BOLD CYAN "   RECENTLY PROCESSED VEHICLES  \n" RESET);
+fprintf(out, " +------------+----------+-----------------+----------------+\n");
+fprintf(out, " | VEHICLE ID | LANE     | TYPE            | STATUS         |\n");
+fprintf(out, " +------------+----------+-----------------+----------------+\n");
+
+// Show current crossings first if any
+for (int i = 0; i < snap->crossing_count; i++) {
+    const Vehicle* cv = &snap->crossing[i];
     char type_str[10];
-    strcpy(type_str, get_vehicle_type_str(crossing_v->type));
+    strcpy(type_str, get_vehicle_type_str(cv->type));
     
     // Manual printing for Crossing to handle ANSI code length
-    printf(" | %-10d | %-8s | %-15s | ", crossing_v->id, dirs[crossing_v->lane], type_str);
-    printf(BOLD GREEN "CROSSING..." RESET);
-    printf("    |\n"); // Fixed padding after "CROSSING..." to hit 16 chars
-} else {
-    printf(" | %-10s | %-8s | %-15s | %-14s |\n", "-", "-", "-", "IDLE");
+    fprintf(out, " | %-10d | %-8s | %-15s | ", cv->id, dirs[cv->lane], type_str);
+    fprintf(out, BOLD GREEN "CROSSING..." RESET);
+    fprintf(out, "    |\n"); // Fixed padding after "CROSSING..." to hit 16 chars
+}
+if (snap->crossing_count == 0) {
+    fprintf(out, " | %-10s | %-8s | %-15s | %-14s |\n", "-", "-", "-", "IDLE");
 }
 
 // Show history
-for(int i = 0; i < history_count; i++) {
-    Vehicle v = history_log[i];
+for(int i = 0; i < snap->history_count; i++) {
+    Vehicle v = snap->history[i];
     char type_str[10];
     strcpy(type_str, get_vehicle_type_str(v.type));
     
@@ -176,23 +581,23 @@ for(int i = 0; i < history_count; i++) {
     char* res = is_emergency ? RESET : "";
 
     // ID Column (Width 10)
-    printf(" | %s%d%s", color, v.id, res);
+    fprintf(out, " | %s%d%s", color, v.id, res);
     int len = snprintf(NULL, 0, "%d", v.id);
-    for(int k = 0; k < 10 - len; k++) putchar(' ');
+    for(int k = 0; k < 10 - len; k++) fputc(' ', out);
 
     // Lane Column (Width 8)
-    printf(" | %-8s", dirs[v.lane]);
+    fprintf(out, " | %-8s", dirs[v.lane]);
 
     // Type Column (Width 15)
-    printf(" | %s%s%s", color, type_str, res);
+    fprintf(out, " | %s%s%s", color, type_str, res);
     len = strlen(type_str);
-    for(int k = 0; k < 15 - len; k++) putchar(' ');
+    for(int k = 0; k < 15 - len; k++) fputc(' ', out);
 
     // Status Column (Width 14) - Kept simple for alignment
-    printf(" | COMPLETED      |\n");
+    fprintf(out, " | COMPLETED      |\n");
 }
 // Fixed the bottom border length to match the top (60 chars total)
-printf(" +------------+----------+-----------------+----------------+\n");
+fprintf(out, " +------------+----------+-----------------+----------------+\n");
 
 
     // 3. TRAFFIC VISUALIZATION (Maintained in Terminal)
@@ -207,38 +612,38 @@ printf(" +------------+----------+-----------------+----------------+\n");
     }
     
     // Lane Colors
-    char* c_n = (green_lane_idx == NORTH) ? BOLD GREEN : RED; 
-    char* c_s = (green_lane_idx == SOUTH) ? BOLD GREEN : RED;
-    char* c_e = (green_lane_idx == EAST) ? BOLD GREEN : RED;
-    char* c_w = (green_lane_idx == WEST) ? BOLD GREEN : RED;
+    char* c_n = (green_mask & (1u << NORTH)) ? BOLD GREEN : RED; 
+    char* c_s = (green_mask & (1u << SOUTH)) ? BOLD GREEN : RED;
+    char* c_e = (green_mask & (1u << EAST)) ? BOLD GREEN : RED;
+    char* c_w = (green_mask & (1u << WEST)) ? BOLD GREEN : RED;
     char* r   = RESET;
 
-printf("\n");
+fprintf(out, "\n");
     // North Lane
-    printf("                    North\n\n");
-    printf("                    %s║   ║%s\n", c_n, r);
-    printf("                    %s║   ║%s\n", c_n, r);
-    printf("                    %s║ | ║%s\n", c_n, r);
-    printf("                    %s║ ↓ ║%s\n", c_n, r);
-    printf("West                %s║   ║%s                East\n", c_n, r);
+    fprintf(out, "                    North\n\n");
+    fprintf(out, "                    %s║   ║%s\n", c_n, r);
+    fprintf(out, "                    %s║   ║%s\n", c_n, r);
+    fprintf(out, "                    %s║ | ║%s\n", c_n, r);
+    fprintf(out, "                    %s║ ↓ ║%s\n", c_n, r);
+    fprintf(out, "West                %s║   ║%s                East\n", c_n, r);
     
     // Top Row (West Border | North Entry | East Border)
-    printf("    %s════════════════%s%s╝   ╚%s%s════════════════%s\n", c_w, r, c_n, r, c_e, r);
+    fprintf(out, "    %s════════════════%s%s╝   ╚%s%s════════════════%s\n", c_w, r, c_n, r, c_e, r);
     
     // Middle Row (West Flow | Center | East Flow)
-    printf("    %s   - - - - > %s  %s  %s < - - - -   %s\n", c_w, r, center, c_e, r);
+    fprintf(out, "    %s   - - - - > %s  %s  %s < - - - -   %s\n", c_w, r, center, c_e, r);
     
     // Bottom Row (West Border | South Entry | East Border)
-    printf("    %s════════════════%s%s╗   ╔%s%s════════════════%s\n", c_w, r, c_s, r, c_e, r);
+    fprintf(out, "    %s════════════════%s%s╗   ╔%s%s════════════════%s\n", c_w, r, c_s, r, c_e, r);
     
     // South Lane
-    printf("                    %s║   ║%s\n", c_s, r);
-    printf("                    %s║ ↑ ║%s\n", c_s, r);
-    printf("                    %s║ | ║%s\n", c_s, r);
-    printf("                    %s║   ║%s\n", c_s, r);
-    printf("                    %s║   ║%s\n", c_s, r);
-    printf("\n                    South\n");   
-    printf("\n");
+    fprintf(out, "                    %s║   ║%s\n", c_s, r);
+    fprintf(out, "                    %s║ ↑ ║%s\n", c_s, r);
+    fprintf(out, "                    %s║ | ║%s\n", c_s, r);
+    fprintf(out, "                    %s║   ║%s\n", c_s, r);
+    fprintf(out, "                    %s║   ║%s\n", c_s, r);
+    fprintf(out, "\n                    South\n");   
+    fprintf(out, "\n");
     
-    printf("\nControls: [1-4] Add Car | [a-d] Add Emergency\n");
+    fprintf(out, "\nControls: [1-4] Add Car | [a-d] Add Emergency\n");
 }
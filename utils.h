@@ -5,12 +5,37 @@
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
+#include <stdint.h>
+#include "sensor.h"
 
 // Vehicle Types
 #define REGULAR_CAR 0
 #define AMBULANCE 1
 #define POLICE 2
 #define FIRE_TRUCK 3
+#define NUM_VEHICLE_TYPES 4
+#define VEHICLE_REMOVED -1 // Lane queue slot already served
+
+// Service classes, most urgent first: FIFO within a class, and a lane is
+// as urgent as its most urgent vehicle
+#define CLASS_FIRE 0
+#define CLASS_AMBULANCE 1
+#define CLASS_POLICE 2
+#define CLASS_AGED 3            // Regular car that waited through AGING_THRESHOLD aging passes
+#define CLASS_CAR 4
+#define NUM_CLASSES 5
+#define NUM_EMERGENCY_CLASSES 3 // FIRE, AMBULANCE, POLICE
+#define CLASS_NONE NUM_CLASSES  // Empty lane
+#define AGING_THRESHOLD 10
+
+static inline int vehicle_class(int type) {
+    switch (type) {
+        case FIRE_TRUCK: return CLASS_FIRE;
+        case AMBULANCE: return CLASS_AMBULANCE;
+        case POLICE: return CLASS_POLICE;
+        default: return CLASS_CAR;
+    }
+}
 
 // Lane Constants
 #define NUM_LANES 4
@@ -36,26 +61,163 @@ typedef struct Vehicle {
     int type; // 0=Regular, 1=Ambulance, 2=Police, 3=FireTruck
     int lane; // 0=N, 1=S, 2=E, 3=W
     time_t arrival_time;
+    int64_t arrival_ns; // Monotonic (live) or virtual (headless) arrival stamp
     int priority_score; // Calculated based on type + wait time
 } Vehicle;
 
-typedef struct Node {
-    Vehicle vehicle;
-    struct Node* next;
-} Node;
+// Lane Queue: chunked ring-buffer deque
+// Vehicles live in fixed-size chunks addressed by absolute position, so the
+// tail is always known (O(1) enqueue) and chunks are reused instead of a
+// malloc/free per car. Emergency vehicles are also recorded in a FIFO of
+// positions per class, so the most urgent one can be served without
+// scanning; its slot is marked VEHICLE_REMOVED and skipped when the head
+// passes over it.
+// Aging is lazy: handle_aging only bumps age_epoch, and a regular car's
+// priority is derived from how many epochs passed since it was queued.
+//
+// Chunks are stored as arrays per field (22 bytes a vehicle instead of a
+// 40-byte Vehicle), and the type bytes sit together, so skipping served
+// slots or emergencies to find the next car is a SIMD byte scan.
+#define LANE_CHUNK_SHIFT 8
+#define LANE_CHUNK_SIZE (1 << LANE_CHUNK_SHIFT)
+
+typedef struct LaneChunk {
+    int8_t type[LANE_CHUNK_SIZE];         // VEHICLE_REMOVED once served
+    uint8_t lane[LANE_CHUNK_SIZE];
+    int32_t id[LANE_CHUNK_SIZE];
+    int32_t arrival_sec[LANE_CHUNK_SIZE]; // arrival_time - time_base
+    uint32_t priority[LANE_CHUNK_SIZE];   // Regular cars: age_epoch at enqueue - priority_score; others: priority_score
+    int64_t arrival_ns[LANE_CHUNK_SIZE];
+} LaneChunk;
+
+typedef struct {
+    uint64_t* pos;             // Ring of queue positions
+    size_t mask;
+    uint64_t head;
+    uint64_t tail;
+} PositionFifo;
+
+// Per-lane summary
+// Updated on every add and removal, so what the dashboard, the state page
+// and the schedulers ask of a lane (counts by type, aged cars, the first
+// few vehicles) is read off here instead of walking the queue. Aged cars
+// are a prefix of the regular ones in queue order (a car queued later has
+// seen fewer aging passes), so one forward-moving marker counts them.
+#define LANE_WINDOW 8                  // Head vehicles tracked (dashboard and state page)
+
+typedef struct {
+    int by_type[NUM_VEHICLE_TYPES];    // Live vehicles per type
+    int aged;                          // Regular cars at or past the aging threshold
+    uint64_t next_unaged;              // Regular cars before this position are counted in `aged`
+    int window_count;
+    uint64_t window[LANE_WINDOW];      // Positions of the first live vehicles, queue order
+} LaneSummary;
+
+struct PriorityIndex;
+
+typedef struct LaneQueue {
+    LaneChunk** chunks;        // Ring of chunk pointers, indexed by (position >> LANE_CHUNK_SHIFT)
+    size_t chunk_mask;         // Ring capacity - 1 (power of two)
+    uint64_t head;             // Absolute position of the oldest slot
+    uint64_t tail;             // Absolute position one past the newest slot
+    int count;                 // Live vehicles (removed slots excluded)
+    int64_t time_base;         // arrival_time of the first vehicle ever queued
+
+    PositionFifo emergency[NUM_EMERGENCY_CLASSES]; // Waiting emergency vehicles by class
+    unsigned emergency_classes; // Bit per class with a vehicle waiting
+
+    unsigned int age_epoch;    // Aging passes applied to this lane
+    int aging_threshold;       // Passes before a regular car counts as aged (0 = AGING_THRESHOLD)
+    LaneSummary summary;
+
+    LaneChunk* spare;          // One released chunk kept for reuse
+
+    struct PriorityIndex* index; // Optional: kept current on every change (see below)
+    int index_lane;
+} LaneQueue;                   // All-zero is a valid empty queue
+
+static inline LaneChunk* lane_chunk(const LaneQueue* q, uint64_t pos) {
+    return q->chunks[(pos >> LANE_CHUNK_SHIFT) & q->chunk_mask];
+}
+
+// Most urgent class waiting in the lane (CLASS_NONE if empty). O(1)
+static inline int lane_top_class(const LaneQueue* q) {
+    if (q->emergency_classes) return __builtin_ctz(q->emergency_classes);
+    if (q->summary.aged > 0) return CLASS_AGED;
+    return q->count > 0 ? CLASS_CAR : CLASS_NONE;
+}
+
+// Cross-lane priority index
+// One lane bitmap per class, each lane filed under its most urgent
+// vehicle. Attached lanes refile themselves on every add, removal and
+// aging pass, so "which lane next" is a ctz for the class and a rotate
+// plus ctz for round robin among its lanes, whatever the lane count (up
+// to the 32 lanes of one bitmap word).
+#define INDEX_MAX_LANES 32
+
+typedef struct PriorityIndex {
+    uint32_t lanes[NUM_CLASSES]; // Bit per lane whose most urgent vehicle is of the class
+    unsigned classes;            // Bit per class with any lane
+    int8_t top[INDEX_MAX_LANES]; // Each lane's class (CLASS_NONE = empty)
+} PriorityIndex;
+
+void priority_index_attach(PriorityIndex* x, LaneQueue lanes[], int n);
+// Lane of the most urgent class no lower than `max_class`, round robin
+// from the one after `current` among lanes of that class; -1 if none
+int priority_index_next(const PriorityIndex* x, int current, int max_class);
+
+static inline int priority_index_top_class(const PriorityIndex* x) {
+    return x->classes ? __builtin_ctz(x->classes) : CLASS_NONE;
+}
+
+// Everything one dashboard frame shows, copied out of the lanes so the
+// frame can be drawn (and written to the terminal) without holding locks
+#define SCENE_PREVIEW 5 // Vehicles listed per lane
+#define MAX_HISTORY 5   // Recently processed vehicles shown
+
+typedef struct {
+    unsigned green_mask;             // Bit per green lane
+    int crossing_count;
+    Vehicle crossing[NUM_LANES];     // Vehicles in the junction
+    int lane_count[NUM_LANES];
+    int lane_emergency[NUM_LANES];
+    int lane_aged[NUM_LANES];
+    int preview_count[NUM_LANES];
+    Vehicle preview[NUM_LANES][SCENE_PREVIEW];
+    int history_count;
+    Vehicle history[MAX_HISTORY];
+    int has_sensors;                 // Filled by the caller when sensors run
+    LaneEstimate sensors[NUM_LANES];
+} SceneSnapshot;
 
-// Linked List Functions
-void add_vehicle(Node** head, Vehicle v);
-Vehicle remove_vehicle(Node** head); /* Removes head (FIFO/Priority depending on logic elsewhere, but here we just pop head for simplicity or could be specific) - actually usually we serve head. */
-Vehicle remove_vehicle_by_id(Node** head, int id); // If needed
-int count_vehicles(Node* head);
-void print_lane_status(Node* head, char* lane_name, int is_green);
+// Lane Queue Functions
+void init_lane_queue(LaneQueue* q);
+void free_lane_queue(LaneQueue* q);
+void add_vehicle(LaneQueue* q, Vehicle v);
+Vehicle remove_vehicle(LaneQueue* q); // Most urgent emergency class first (FIFO within it), else head
+Vehicle remove_vehicle_by_id(LaneQueue* q, int id); // id -1 if not queued
+int count_vehicles(const LaneQueue* q);
+int count_vehicles_of_type(const LaneQueue* q, int type);
+int count_aged_vehicles(const LaneQueue* q); // Regular cars at or past the aging threshold
+void age_lane(LaneQueue* q, int passes);     // Applies aging passes (see handle_aging)
+int lane_has_emergency_vehicle(const LaneQueue* q);
+int first_emergency_vehicle(const LaneQueue* q, Vehicle* out); // The one remove_vehicle serves next: 1 = copied out, 0 = none
+int peek_vehicles(const LaneQueue* q, Vehicle* out, int max); // First `max` in queue order
+int remove_head_vehicles(LaneQueue* q, Vehicle* out, int max); // Up to `max` regular cars from the head, FIFO
+void print_lane_status(LaneQueue* q, char* lane_name, int is_green);
 
 // UI Helpers
 void clear_screen();
 void print_header();
 const char* get_vehicle_type_str(int type);
-void draw_traffic_scene(Node* lanes[], int green_lane_idx, Vehicle* crossing_v);
+// green_mask: bit per green lane; crossing: NUM_LANES slots, id -1 when
+// that lane has nothing in the junction (NULL = nothing crossing)
+void draw_traffic_scene(LaneQueue lanes[], unsigned green_mask, const Vehicle crossing[]);
+void draw_traffic_scene_to(FILE* out, LaneQueue lanes[], unsigned green_mask, const Vehicle crossing[]);
+void capture_scene(SceneSnapshot* s, LaneQueue lanes[], unsigned green_mask, const Vehicle crossing[]);
+void draw_scene_snapshot(FILE* out, const SceneSnapshot* s);
 void log_vehicle(Vehicle v);
+int64_t monotonic_ns(); // CLOCK_MONOTONIC in nanoseconds (comparable across processes)
+int sleep_until_ns(int64_t deadline); // Absolute monotonic_ns() deadline: 0 = reached, -1 = interrupted by a signal
 
 #endif